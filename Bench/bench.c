@@ -0,0 +1,164 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "stm32f407xx.h"
+#include "bench.h"
+#include "kernel.h"
+#include "kernel_semaphore.h"
+
+static void bench_uart_initialize(void);
+static void bench_load_main(uint32_t index);
+static int bench_compare(const void* a, const void* b);
+
+static uint32_t bench_seed = 1U;
+static volatile uint32_t bench_load_active;
+static kernel_semaphore_type bench_load_semaphore;
+static uint32_t bench_load_stacks[BENCH_LOAD_MAX][128];
+static tcb_type bench_loads[BENCH_LOAD_MAX];
+
+void bench_initialize(void)
+{
+	/* The DWT block is only clocked once trace is enabled in the debug monitor control register.
+	 * A debugger usually does this for us, but the benchmark must also work when the board is running standalone.
+	 */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0U;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	bench_uart_initialize();
+}
+
+static void bench_uart_initialize(void)
+{
+	/* Enable the clocks for GPIO Port A and USART2 */
+	RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN;
+	RCC->APB1ENR |= RCC_APB1ENR_USART2EN;
+
+	/* PA2 is USART2 TX. Set the pin to alternate function mode 0b10 and select AF7 */
+	GPIOA->MODER &= ~GPIO_MODER_MODER2_Msk;
+	GPIOA->MODER |= GPIO_MODER_MODER2_1;
+	GPIOA->AFR[0] &= ~GPIO_AFRL_AFSEL2_Msk;
+	GPIOA->AFR[0] |= (7U << GPIO_AFRL_AFSEL2_Pos);
+
+	/* With oversampling by 16 the BRR register holds fclk / baudrate as a 12.4 fixed point number,
+	 * so the rounded integer division gives the mantissa and fraction in one go.
+	 */
+	USART2->BRR = (BENCH_SYSTEM_CLOCK + (BENCH_BAUDRATE / 2U)) / BENCH_BAUDRATE;
+	USART2->CR1 = USART_CR1_TE | USART_CR1_UE;
+}
+
+/* Overrides the weak declaration in Src/syscalls.c so printf() goes out over USART2 */
+int __io_putchar(int ch)
+{
+	while ((USART2->SR & USART_SR_TXE) == 0U) {}
+	USART2->DR = (uint32_t)ch & 0xFFU;
+
+	return ch;
+}
+
+void bench_random_seed(uint32_t seed)
+{
+	bench_seed = seed;
+}
+
+uint32_t bench_random(void)
+{
+	bench_seed = (bench_seed * 1664525U) + 1013904223U;
+	return bench_seed >> 8;
+}
+
+void bench_trigger_start(void)
+{
+	bench_random_seed(1U);
+
+	RCC->APB1ENR |= RCC_APB1ENR_TIM2EN;
+
+	/* No prescaler, TIM2 runs from the same 16 MHz as the core */
+	TIM2->CR1 = 0U;
+	TIM2->PSC = 0U;
+	TIM2->ARR = BENCH_TRIGGER_PERIOD_MIN;
+	TIM2->CNT = 0U;
+	TIM2->EGR = TIM_EGR_UG;
+	TIM2->SR = 0U;
+	TIM2->DIER = TIM_DIER_UIE;
+	TIM2->CR1 = TIM_CR1_CEN;
+}
+
+void bench_trigger_stop(void)
+{
+	TIM2->CR1 = 0U;
+	TIM2->SR = 0U;
+}
+
+/* TIM2 counts core clock cycles since the update event, so the counter is read before anything else */
+uint32_t bench_trigger_acknowledge(void)
+{
+	uint32_t elapsed = TIM2->CNT;
+
+	TIM2->SR = 0U;
+	TIM2->ARR = BENCH_TRIGGER_PERIOD_MIN + (bench_random() % BENCH_TRIGGER_PERIOD_SPAN);
+
+	return elapsed;
+}
+
+void bench_load_start(uint8_t priority)
+{
+	uint32_t i;
+
+	kernel_semaphore_initialize(&bench_load_semaphore, 0U);
+
+	for (i = 0U; i < BENCH_LOAD_MAX; i++) {
+		kernel_tcb_start_argument(
+			&bench_loads[i],
+			priority,
+			(tcb_type_handler)&bench_load_main,
+			(void*)i,
+			bench_load_stacks[i],
+			sizeof(bench_load_stacks[i]));
+	}
+}
+
+void bench_load_set(uint32_t active)
+{
+	bench_load_active = active;
+}
+
+static void bench_load_main(uint32_t index)
+{
+	while (1) {
+		if (index < bench_load_active) {
+			kernel_semaphore_give(&bench_load_semaphore);
+			(void)kernel_semaphore_take(&bench_load_semaphore, 1U);
+		} else {
+			kernel_tcb_block(10U);
+		}
+	}
+}
+
+void bench_percentiles_print(uint32_t* samples, uint32_t count)
+{
+	uint64_t sum = 0U;
+	uint32_t i;
+
+	qsort(samples, count, sizeof(samples[0]), &bench_compare);
+	for (i = 0U; i < count; i++) {
+		sum += samples[i];
+	}
+
+	printf("%lu,%lu,%lu,%lu,%lu,%lu,%lu",
+		(unsigned long)count,
+		(unsigned long)samples[0],
+		(unsigned long)samples[(count * 50U) / 100U],
+		(unsigned long)samples[(count * 90U) / 100U],
+		(unsigned long)samples[(count * 99U) / 100U],
+		(unsigned long)samples[count - 1U],
+		(unsigned long)(sum / count));
+}
+
+static int bench_compare(const void* a, const void* b)
+{
+	uint32_t x = *(const uint32_t*)a;
+	uint32_t y = *(const uint32_t*)b;
+
+	return (x > y) - (x < y);
+}
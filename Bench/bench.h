@@ -0,0 +1,62 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+#include "stm32f407xx.h"
+
+/* Benchmark applications are standalone programs that replace Src/main.c.
+ * Results are printed with printf() which ends up in __io_putchar() inside bench.c (USART2 TX on PA2, 115200 8N1).
+ */
+
+#define BENCH_SYSTEM_CLOCK	16000000U	/* 16 MHz HSI, same as Src/systick.c */
+#define BENCH_BAUDRATE		115200U
+
+void bench_initialize(void);
+
+/* Longest finite timeout, about 49 days of 1 ms ticks. Unlike a thread waiting with KERNEL_WAIT_FOREVER, one
+ * 	blocked on it stays on the delayed list and is counted down every tick, for benchmarks that need it populated.
+ */
+#define BENCH_TIMEOUT_PARKED	0xFFFFFFFFU
+
+/* Small LCG so every run of a benchmark sees the same sequence */
+void bench_random_seed(uint32_t seed);
+uint32_t bench_random(void);
+
+/* Random trigger on TIM2, which overflows at pseudo random points in time asynchronous to whatever the threads do.
+ * The benchmark defines TIM2_IRQHandler() and calls bench_trigger_acknowledge() first. It returns the core clock
+ * 	cycles since the overflow, which is when the trigger really happened, so the trigger time can be back dated to
+ * 	include interrupt entry and any time spent with interrupts masked.
+ * bench_trigger_start() restarts the random sequence, so every run triggers at the same points.
+ */
+#define BENCH_TRIGGER_PERIOD_MIN	4000U		/* cycles between triggers, long enough for the previous sample to finish */
+#define BENCH_TRIGGER_PERIOD_SPAN	16000U
+
+void bench_trigger_start(void);
+void bench_trigger_stop(void);
+uint32_t bench_trigger_acknowledge(void);
+
+/* Background load of BENCH_LOAD_MAX threads that share one priority and keep giving and taking a semaphore, so an
+ * 	interrupt regularly lands in a kernel critical section or a time slice rotation. Only the first active of them
+ * 	run, the rest sleep.
+ */
+#define BENCH_LOAD_MAX		8U
+
+void bench_load_start(uint8_t priority);
+void bench_load_set(uint32_t active);
+
+/* Sorts the samples in place and prints the columns of BENCH_PERCENTILES_HEADER without a line end, so the caller
+ * 	prints its own columns before and after them
+ */
+#define BENCH_PERCENTILES_HEADER	"samples,min,p50,p90,p99,max,mean"
+
+void bench_percentiles_print(uint32_t* samples, uint32_t count);
+
+/* The DWT cycle counter is a free running 32 bit counter clocked by the CPU.
+ * At 16 MHz it wraps every ~268 seconds, which is more than enough for a single measurement window.
+ */
+static inline uint32_t bench_cycles(void)
+{
+	return DWT->CYCCNT;
+}
+
+#endif /* BENCH_H_ */
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include "stm32f407xx.h"
+#include "bench.h"
+#include "kernel.h"
+#include "kernel_notify.h"
+#include "active_object.h"
+#include "systick.h"
+
+/* Events per second and RAM per component, active objects against one thread per component.
+ *
+ * Both models bounce a message between two components BENCH_EVENTS times.
+ * The AOs post a static event to each other and are both run by the one dispatcher thread.
+ * The threads signal each other with direct to task notifications, so every hand off is a full context switch.
+ * The thread stacks are the same 40 words Src/main.c gives its blinky threads.
+ */
+#define BENCH_EVENTS		10000U
+#define BENCH_QUEUE_LENGTH	4U
+
+enum {
+	BENCH_SIGNAL_BALL = AO_SIGNAL_USER
+};
+
+typedef struct {
+	ao_type super;
+	ao_type* peer;
+} bench_player_type;
+
+static const ao_event_type bench_ball = { BENCH_SIGNAL_BALL, 0U, 0U };
+static volatile uint32_t bench_count;
+
+uint32_t driver_stack[512];
+tcb_type driver;
+
+static ao_state_result bench_player_playing(bench_player_type* me, const ao_event_type* e);
+
+static ao_state_result bench_player_initial(bench_player_type* me, const ao_event_type* e)
+{
+	(void)e;
+	return AO_TRAN(&bench_player_playing);
+}
+
+static ao_state_result bench_player_playing(bench_player_type* me, const ao_event_type* e)
+{
+	if (e->signal == BENCH_SIGNAL_BALL) {
+		if (++bench_count < BENCH_EVENTS) {
+			(void)ao_post(me->peer, &bench_ball);
+		} else {
+			kernel_notify(&driver, 0U, KERNEL_NOTIFY_INCREMENT);
+		}
+		return AO_HANDLED();
+	}
+
+	return AO_SUPER(&ao_state_top);
+}
+
+static bench_player_type ping;
+static bench_player_type pong;
+static const ao_event_type* ping_queue[BENCH_QUEUE_LENGTH];
+static const ao_event_type* pong_queue[BENCH_QUEUE_LENGTH];
+
+uint32_t dispatcher_stack[128];
+tcb_type dispatcher;
+
+uint32_t thread_a_stack[40];
+tcb_type thread_a;
+uint32_t thread_b_stack[40];
+tcb_type thread_b;
+
+static void bench_thread_player(tcb_type* peer)
+{
+	while (1) {
+		(void)kernel_notify_wait(0xFFFFFFFFU, (uint32_t*)0U, KERNEL_WAIT_FOREVER);
+
+		if (++bench_count < BENCH_EVENTS) {
+			kernel_notify(peer, 0U, KERNEL_NOTIFY_INCREMENT);
+		} else {
+			kernel_notify(&driver, 0U, KERNEL_NOTIFY_INCREMENT);
+		}
+	}
+}
+
+void main_thread_a(void)
+{
+	bench_thread_player(&thread_b);
+}
+
+void main_thread_b(void)
+{
+	bench_thread_player(&thread_a);
+}
+
+static void bench_report(const char* model, uint32_t cycles, uint32_t ram_per_component)
+{
+	uint64_t events_per_second = ((uint64_t)BENCH_EVENTS * BENCH_SYSTEM_CLOCK) / cycles;
+
+	printf("%s,%lu,%lu,%lu,%lu\r\n",
+		model,
+		(unsigned long)BENCH_EVENTS,
+		(unsigned long)(cycles / BENCH_EVENTS),
+		(unsigned long)events_per_second,
+		(unsigned long)ram_per_component);
+}
+
+void main_driver(void)
+{
+	uint32_t start;
+
+	printf("model,events,cycles_per_event,events_per_second,ram_per_component\r\n");
+
+	bench_count = 0U;
+	start = bench_cycles();
+	(void)ao_post(&ping.super, &bench_ball);
+	(void)kernel_notify_wait(0xFFFFFFFFU, (uint32_t*)0U, KERNEL_WAIT_FOREVER);
+	bench_report("active_object", bench_cycles() - start, sizeof(bench_player_type) + sizeof(ping_queue));
+
+	bench_count = 0U;
+	start = bench_cycles();
+	kernel_notify(&thread_a, 0U, KERNEL_NOTIFY_INCREMENT);
+	(void)kernel_notify_wait(0xFFFFFFFFU, (uint32_t*)0U, KERNEL_WAIT_FOREVER);
+	bench_report("thread", bench_cycles() - start, sizeof(tcb_type) + sizeof(thread_a_stack));
+
+	while (1) {
+		kernel_tcb_block(KERNEL_WAIT_FOREVER);
+	}
+}
+
+int main(void)
+{
+	bench_initialize();
+	kernel_initialize();
+	systick_initialize();
+
+	/* Keep both models above the driver so it only wakes up once a run is finished */
+	ao_framework_start(&dispatcher, 2U, dispatcher_stack, sizeof(dispatcher_stack));
+
+	ping.peer = &pong.super;
+	pong.peer = &ping.super;
+	(void)ao_start(&ping.super, 1U, (ao_state_handler)&bench_player_initial, ping_queue, BENCH_QUEUE_LENGTH);
+	(void)ao_start(&pong.super, 2U, (ao_state_handler)&bench_player_initial, pong_queue, BENCH_QUEUE_LENGTH);
+
+	kernel_tcb_start(&thread_a, 3U, &main_thread_a, thread_a_stack, sizeof(thread_a_stack));
+	kernel_tcb_start(&thread_b, 3U, &main_thread_b, thread_b_stack, sizeof(thread_b_stack));
+
+	kernel_tcb_start(&driver, 1U, &main_driver, driver_stack, sizeof(driver_stack));
+
+	kernel_run();
+}
@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include "stm32f407xx.h"
+#include "bench.h"
+#include "kernel.h"
+#include "kernel_notify.h"
+#include "systick.h"
+
+/* Interrupt to thread wake up latency, split in to segments, under increasing background load.
+ * Needs the whole project built with -DKERNEL_TRACE=1 so the schedulers timestamp the moment they pend PendSV.
+ *
+ * TIM2 fires at pseudo random points in time, asynchronous to whatever the load is doing, and pends the EXTI1
+ * 	interrupt through NVIC->STIR. The EXTI1 handler notifies the highest priority waiter thread. Four timestamps are
+ * 	taken per sample:
+ * 	trigger	when TIM2 overflowed, back dated by its counter so time spent with interrupts masked is included
+ * 	entry	first line of the EXTI1 handler
+ * 	pendsv	the scheduler setting the PendSV pending bit in SCB->ICSR
+ * 	resume	the waiter returning from kernel_notify_wait()
+ *
+ * All timestamps come from kernel_trace_timestamp(), which uses the DWT cycle counter on the board and falls back
+ * 	to the Systick when the DWT doesn't count, as under QEMU. The output format is the same either way.
+ * The load threads of bench.c run below the waiter.
+ */
+#if !KERNEL_TRACE
+#error "bench_irq_latency.c needs the project built with -DKERNEL_TRACE=1"
+#endif
+
+#define BENCH_SAMPLES		500U
+
+typedef enum {
+	BENCH_SEGMENT_ENTRY = 0,
+	BENCH_SEGMENT_ISR,
+	BENCH_SEGMENT_SWITCH,
+	BENCH_SEGMENT_TOTAL,
+	BENCH_SEGMENTS
+} bench_segment_type;
+
+static const char* const bench_segment_names[BENCH_SEGMENTS] = {
+	"trigger_to_entry",
+	"entry_to_pendsv",
+	"pendsv_to_resume",
+	"trigger_to_resume"
+};
+
+static uint32_t bench_samples[BENCH_SEGMENTS][BENCH_SAMPLES];
+static volatile uint32_t bench_count;
+static volatile uint32_t bench_trigger;
+static volatile uint32_t bench_entry;
+static volatile uint32_t bench_busy;
+
+uint32_t waiter_stack[128];
+tcb_type waiter;
+uint32_t driver_stack[512];
+tcb_type driver;
+
+void main_waiter(void)
+{
+	while (1) {
+		uint32_t resume;
+		uint32_t count;
+
+		(void)kernel_notify_wait(0xFFFFFFFFU, (uint32_t*)0U, KERNEL_WAIT_FOREVER);
+		resume = kernel_trace_timestamp();
+
+		count = bench_count;
+		if (count < BENCH_SAMPLES) {
+			bench_samples[BENCH_SEGMENT_ENTRY][count] = bench_entry - bench_trigger;
+			bench_samples[BENCH_SEGMENT_ISR][count] = kernel_trace_pendsv_set - bench_entry;
+			bench_samples[BENCH_SEGMENT_SWITCH][count] = resume - kernel_trace_pendsv_set;
+			bench_samples[BENCH_SEGMENT_TOTAL][count] = resume - bench_trigger;
+			bench_count = count + 1U;
+
+			if ((count + 1U) == BENCH_SAMPLES) {
+				kernel_notify(&driver, 0U, KERNEL_NOTIFY_INCREMENT);
+			}
+		}
+		bench_busy = 0U;
+	}
+}
+
+void TIM2_IRQHandler(void)
+{
+	uint32_t elapsed = bench_trigger_acknowledge();
+	uint32_t now = kernel_trace_timestamp();
+
+	if (bench_busy == 0U) {
+		bench_busy = 1U;
+		bench_trigger = now - elapsed;
+		NVIC->STIR = EXTI1_IRQn;
+	}
+}
+
+void EXTI1_IRQHandler(void)
+{
+	bench_entry = kernel_trace_timestamp();
+	kernel_notify(&waiter, 0U, KERNEL_NOTIFY_INCREMENT);
+}
+
+static void bench_report(uint32_t load)
+{
+	uint32_t segment;
+
+	for (segment = 0U; segment < BENCH_SEGMENTS; segment++) {
+		printf("%lu,%s,", (unsigned long)load, bench_segment_names[segment]);
+		bench_percentiles_print(bench_samples[segment], BENCH_SAMPLES);
+		printf("\r\n");
+	}
+}
+
+void main_driver(void)
+{
+	static const uint32_t load_levels[] = {0U, 1U, 2U, 4U, 8U};
+	uint32_t level;
+
+	printf("load_threads,segment," BENCH_PERCENTILES_HEADER "\r\n");
+
+	for (level = 0U; level < (sizeof(load_levels) / sizeof(load_levels[0])); level++) {
+		bench_load_set(load_levels[level]);
+		bench_count = 0U;
+		bench_busy = 0U;
+
+		bench_trigger_start();
+		(void)kernel_notify_wait(0xFFFFFFFFU, (uint32_t*)0U, KERNEL_WAIT_FOREVER);
+		bench_trigger_stop();
+
+		bench_report(load_levels[level]);
+	}
+
+	printf("done\r\n");
+
+	bench_load_set(0U);
+	while (1) {
+		kernel_tcb_block(KERNEL_WAIT_FOREVER);
+	}
+}
+
+int main(void)
+{
+	bench_initialize();
+	kernel_initialize();
+	systick_initialize();
+
+	/* TIM2 above EXTI1 so the trigger is never held up by the interrupt it measures, both below Systick */
+	NVIC_SetPriority(TIM2_IRQn, 1U);
+	NVIC_EnableIRQ(TIM2_IRQn);
+	NVIC_SetPriority(EXTI1_IRQn, 2U);
+	NVIC_EnableIRQ(EXTI1_IRQn);
+
+	kernel_tcb_start(
+		&waiter,
+		3U,
+		&main_waiter,
+		waiter_stack,
+		sizeof(waiter_stack));
+
+	kernel_tcb_start(
+		&driver,
+		2U,
+		&main_driver,
+		driver_stack,
+		sizeof(driver_stack));
+
+	bench_load_start(1U);
+
+	kernel_run();
+}
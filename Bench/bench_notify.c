@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include "stm32f407xx.h"
+#include "bench.h"
+#include "kernel.h"
+#include "kernel_notify.h"
+#include "kernel_semaphore.h"
+#include "systick.h"
+
+/* ISR to thread wake up latency, direct to task notification against a counting semaphore.
+ *
+ * The driver thread pends the otherwise unused EXTI0 interrupt from software, and the ISR signals the higher priority
+ * waiter thread. The latency is measured from just before the interrupt is pended until the waiter returns from its
+ * wait call, so it covers the ISR, the signalling call, the scheduler and the PendSV context switch.
+ */
+#define BENCH_SAMPLES		1000U
+
+typedef enum {
+	BENCH_MODE_NOTIFY = 0,
+	BENCH_MODE_SEMAPHORE
+} bench_mode_type;
+
+typedef struct {
+	uint32_t min;
+	uint32_t max;
+	uint32_t sum;
+	uint32_t count;
+} bench_stats_type;
+
+static volatile bench_mode_type bench_mode;
+static volatile uint32_t bench_start;
+static bench_stats_type bench_stats;
+static kernel_semaphore_type bench_semaphore;
+
+uint32_t waiter_stack[128];
+tcb_type waiter;
+void main_waiter(void)
+{
+	while (1) {
+		uint32_t latency;
+
+		if (bench_mode == BENCH_MODE_NOTIFY) {
+			(void)kernel_notify_wait(0xFFFFFFFFU, (uint32_t*)0U, KERNEL_WAIT_FOREVER);
+		} else {
+			(void)kernel_semaphore_take(&bench_semaphore, KERNEL_WAIT_FOREVER);
+		}
+		latency = bench_cycles() - bench_start;
+
+		if (latency < bench_stats.min) {
+			bench_stats.min = latency;
+		}
+		if (latency > bench_stats.max) {
+			bench_stats.max = latency;
+		}
+		bench_stats.sum += latency;
+		bench_stats.count++;
+	}
+}
+
+void EXTI0_IRQHandler(void)
+{
+	if (bench_mode == BENCH_MODE_NOTIFY) {
+		kernel_notify(&waiter, 0U, KERNEL_NOTIFY_INCREMENT);
+	} else {
+		kernel_semaphore_give(&bench_semaphore);
+	}
+}
+
+static void bench_run(bench_mode_type mode, const char* name)
+{
+	uint32_t i;
+
+	/* Kick the waiter out of its notification wait so it picks up the new mode and blocks on the matching primitive.
+	 * The sample it records on the way out is thrown away when the stats are reset.
+	 */
+	bench_mode = mode;
+	kernel_notify(&waiter, 0U, KERNEL_NOTIFY_INCREMENT);
+	kernel_tcb_block(2U);
+
+	bench_stats.min = 0xFFFFFFFFU;
+	bench_stats.max = 0U;
+	bench_stats.sum = 0U;
+	bench_stats.count = 0U;
+
+	/* The waiter has the higher priority, so by the time NVIC_SetPendingIRQ() returns to this thread the waiter has
+	 * 	already woken up, recorded its sample and blocked again.
+	 */
+	for (i = 0; i < BENCH_SAMPLES; i++) {
+		bench_start = bench_cycles();
+		NVIC_SetPendingIRQ(EXTI0_IRQn);
+	}
+
+	printf("%s,%lu,%lu,%lu,%lu\r\n",
+		name,
+		(unsigned long)bench_stats.count,
+		(unsigned long)bench_stats.min,
+		(unsigned long)(bench_stats.sum / bench_stats.count),
+		(unsigned long)bench_stats.max);
+}
+
+uint32_t driver_stack[512];
+tcb_type driver;
+void main_driver(void)
+{
+	printf("primitive,samples,min_cycles,avg_cycles,max_cycles\r\n");
+	bench_run(BENCH_MODE_NOTIFY, "notify");
+	bench_run(BENCH_MODE_SEMAPHORE, "semaphore");
+
+	while (1) {
+		kernel_tcb_block(KERNEL_WAIT_FOREVER);
+	}
+}
+
+int main(void)
+{
+	bench_initialize();
+	kernel_initialize();
+	systick_initialize();
+
+	kernel_semaphore_initialize(&bench_semaphore, 0U);
+
+	/* Any priority works for the test interrupt since the kernel masks with PRIMASK, keep it below Systick */
+	NVIC_SetPriority(EXTI0_IRQn, 1U);
+	NVIC_EnableIRQ(EXTI0_IRQn);
+
+	kernel_tcb_start(
+		&waiter,
+		2U,
+		&main_waiter,
+		waiter_stack,
+		sizeof(waiter_stack));
+
+	kernel_tcb_start(
+		&driver,
+		1U,
+		&main_driver,
+		driver_stack,
+		sizeof(driver_stack));
+
+	kernel_run();
+}
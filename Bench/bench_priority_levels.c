@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include "stm32f407xx.h"
+#include "bench.h"
+#include "kernel.h"
+#include "kernel_bitmap.h"
+#include "systick.h"
+
+/* Scheduler cost against the number of priority levels.
+ * KERNEL_PRIORITY_MAX has to be defined for the whole project, build once each with -DKERNEL_PRIORITY_MAX=32, 64 and 255.
+ *
+ * The driver thread sits at the very top priority and a single spinning thread sits at priority 1, so the two ready
+ * bits are as far apart in the bitmap as they can be. Both schedulers should report the same cycle count at every size.
+ */
+#define BENCH_ITERATIONS	1000U
+
+uint32_t subject_stack[40];
+tcb_type subject;
+void main_subject(void)
+{
+	while (1) {}
+}
+
+uint32_t driver_stack[512];
+tcb_type driver;
+void main_driver(void)
+{
+	uint32_t i;
+	uint32_t start;
+	uint32_t priority_based;
+	uint32_t round_robin;
+
+	/* Each scheduler call may pend PendSV, so clear the pending bit afterwards and let the priority based scheduler
+	 * point next_thread back at the driver thread before interrupts are enabled again.
+	 */
+	__disable_irq();
+	start = bench_cycles();
+	for (i = 0; i < BENCH_ITERATIONS; i++) {
+		kernel_scheduler_priority_based();
+	}
+	priority_based = bench_cycles() - start;
+
+	start = bench_cycles();
+	for (i = 0; i < BENCH_ITERATIONS; i++) {
+		kernel_scheduler_round_robin();
+	}
+	round_robin = bench_cycles() - start;
+
+	SCB->ICSR = SCB_ICSR_PENDSVCLR_Msk;
+	kernel_scheduler_priority_based();
+	__enable_irq();
+
+	printf("bench,levels,cycles_per_pick\r\n");
+	printf("priority_based,%u,%lu\r\n", (unsigned)KERNEL_PRIORITY_MAX + 1U, (unsigned long)(priority_based / BENCH_ITERATIONS));
+	printf("round_robin,%u,%lu\r\n", (unsigned)KERNEL_PRIORITY_MAX + 1U, (unsigned long)(round_robin / BENCH_ITERATIONS));
+
+	while (1) {
+		kernel_tcb_block(KERNEL_WAIT_FOREVER);
+	}
+}
+
+int main(void)
+{
+	bench_initialize();
+	kernel_initialize();
+	systick_initialize();
+
+	kernel_tcb_start(
+		&subject,
+		1U,
+		&main_subject,
+		subject_stack,
+		sizeof(subject_stack));
+
+	kernel_tcb_start(
+		&driver,
+		KERNEL_PRIORITY_MAX,
+		&main_driver,
+		driver_stack,
+		sizeof(driver_stack));
+
+	kernel_run();
+}
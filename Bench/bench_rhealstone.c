@@ -0,0 +1,331 @@
+#include <stdio.h>
+#include "stm32f407xx.h"
+#include "bench.h"
+#include "kernel.h"
+#include "kernel_bitmap.h"
+#include "kernel_notify.h"
+#include "kernel_resource.h"
+#include "kernel_semaphore.h"
+#include "ring_buffer.h"
+#include "systick.h"
+
+/* Rhealstone style suite: the six classic real time kernel figures, each measured with the DWT cycle counter.
+ *
+ * task_switch		one thread notifies an equal priority peer and waits, until the peer runs (there is no yield call)
+ * preemption		a low priority thread notifies a higher priority one, until the higher priority one runs
+ * interrupt_latency	pending an interrupt through NVIC->STIR, until the first line of its handler
+ * semaphore_shuffle	kernel_semaphore_give() to a waiting higher priority thread, until that thread owns it
+ * deadlock_break	kernel_resource_unlock() by a low priority owner, until the higher priority thread that was made
+ * 			ready meanwhile holds the resource. The ceiling protocol never lets the lock be found taken, so this
+ * 			is the cost of handing it over instead of breaking a real deadlock
+ * message_latency	pushing a 4 byte message in to a ring buffer, until the waiting higher priority consumer has it
+ *
+ * Prints a table for reading and csv lines for scripts, plus a config line so results of different builds and
+ * 	scheduler options can be told apart. The Rhealstone figure is 1 second divided by the sum of the averages.
+ */
+#define BENCH_SAMPLES		1000U
+#define BENCH_PRIORITY_DRIVER	1U
+#define BENCH_PRIORITY_SWITCH	2U
+#define BENCH_PRIORITY_HIGH	3U
+
+typedef enum {
+	BENCH_TASK_SWITCH = 0,
+	BENCH_PREEMPTION,
+	BENCH_INTERRUPT_LATENCY,
+	BENCH_SEMAPHORE_SHUFFLE,
+	BENCH_DEADLOCK_BREAK,
+	BENCH_MESSAGE_LATENCY,
+	BENCH_METRICS
+} bench_metric_type;
+
+typedef struct {
+	uint32_t min;
+	uint32_t max;
+	uint32_t sum;
+	uint32_t count;
+} bench_stats_type;
+
+static const char* const bench_metric_names[BENCH_METRICS] = {
+	"task_switch",
+	"preemption",
+	"interrupt_latency",
+	"semaphore_shuffle",
+	"deadlock_break",
+	"message_latency"
+};
+
+static bench_stats_type bench_stats[BENCH_METRICS];
+static volatile uint32_t bench_start;
+static volatile uint32_t bench_switch_rounds;
+static kernel_semaphore_type bench_semaphore;
+static kernel_resource_type bench_resource;
+static ring_buffer_type bench_ring;
+static uint8_t bench_ring_memory[64];	/* multiple of the message size, so a message is never split over the wrap */
+
+static void bench_record(bench_metric_type metric, uint32_t cycles)
+{
+	bench_stats_type* stats = &bench_stats[metric];
+
+	if (cycles < stats->min) {
+		stats->min = cycles;
+	}
+	if (cycles > stats->max) {
+		stats->max = cycles;
+	}
+	stats->sum += cycles;
+	stats->count++;
+}
+
+/* Both task switch threads run this with the other one as the peer. Each wake up but the very first is a sample. */
+uint32_t switch_a_stack[128];
+tcb_type switch_a;
+uint32_t switch_b_stack[128];
+tcb_type switch_b;
+void main_switch(tcb_type* peer)
+{
+	while (1) {
+		(void)kernel_notify_wait(0xFFFFFFFFU, (uint32_t*)0U, KERNEL_WAIT_FOREVER);
+		if (bench_start != 0U) {
+			bench_record(BENCH_TASK_SWITCH, bench_cycles() - bench_start);
+			bench_start = 0U;
+		}
+
+		if (bench_switch_rounds != 0U) {
+			bench_switch_rounds--;
+			bench_start = bench_cycles();
+			kernel_notify(peer, 0U, KERNEL_NOTIFY_INCREMENT);
+		}
+	}
+}
+
+uint32_t preempt_stack[128];
+tcb_type preempt;
+void main_preempt(void)
+{
+	while (1) {
+		(void)kernel_notify_wait(0xFFFFFFFFU, (uint32_t*)0U, KERNEL_WAIT_FOREVER);
+		bench_record(BENCH_PREEMPTION, bench_cycles() - bench_start);
+	}
+}
+
+void EXTI0_IRQHandler(void)
+{
+	bench_record(BENCH_INTERRUPT_LATENCY, bench_cycles() - bench_start);
+}
+
+uint32_t shuffle_stack[128];
+tcb_type shuffle;
+void main_shuffle(void)
+{
+	while (1) {
+		(void)kernel_semaphore_take(&bench_semaphore, KERNEL_WAIT_FOREVER);
+		bench_record(BENCH_SEMAPHORE_SHUFFLE, bench_cycles() - bench_start);
+	}
+}
+
+uint32_t deadlock_stack[128];
+tcb_type deadlock;
+void main_deadlock(void)
+{
+	while (1) {
+		(void)kernel_notify_wait(0xFFFFFFFFU, (uint32_t*)0U, KERNEL_WAIT_FOREVER);
+		kernel_resource_lock(&bench_resource);
+		bench_record(BENCH_DEADLOCK_BREAK, bench_cycles() - bench_start);
+		kernel_resource_unlock(&bench_resource);
+	}
+}
+
+/* The message carries its own send timestamp */
+uint32_t message_stack[128];
+tcb_type message;
+void main_message(void)
+{
+	while (1) {
+		uint32_t sent;
+
+		while (ring_buffer_pop(&bench_ring, (uint8_t*)&sent, sizeof(sent)) != sizeof(sent)) {
+			(void)ring_buffer_wait(&bench_ring, KERNEL_WAIT_FOREVER);
+		}
+		bench_record(BENCH_MESSAGE_LATENCY, bench_cycles() - sent);
+	}
+}
+
+/* Every sample that wakes a higher priority thread has been recorded by the time the call returns to the driver */
+static void bench_run(bench_metric_type metric)
+{
+	uint32_t i;
+
+	bench_stats[metric].min = 0xFFFFFFFFU;
+	bench_stats[metric].max = 0U;
+	bench_stats[metric].sum = 0U;
+	bench_stats[metric].count = 0U;
+
+	switch (metric) {
+	case BENCH_TASK_SWITCH:
+		/* The pair ping pongs at a priority above the driver, which only runs again once both are waiting */
+		bench_start = 0U;
+		bench_switch_rounds = BENCH_SAMPLES;
+		kernel_notify(&switch_a, 0U, KERNEL_NOTIFY_INCREMENT);
+		break;
+	case BENCH_PREEMPTION:
+		for (i = 0U; i < BENCH_SAMPLES; i++) {
+			bench_start = bench_cycles();
+			kernel_notify(&preempt, 0U, KERNEL_NOTIFY_INCREMENT);
+		}
+		break;
+	case BENCH_INTERRUPT_LATENCY:
+		for (i = 0U; i < BENCH_SAMPLES; i++) {
+			bench_start = bench_cycles();
+			NVIC->STIR = EXTI0_IRQn;
+			__DSB();
+			__ISB();
+		}
+		break;
+	case BENCH_SEMAPHORE_SHUFFLE:
+		for (i = 0U; i < BENCH_SAMPLES; i++) {
+			bench_start = bench_cycles();
+			kernel_semaphore_give(&bench_semaphore);
+		}
+		break;
+	case BENCH_DEADLOCK_BREAK:
+		for (i = 0U; i < BENCH_SAMPLES; i++) {
+			kernel_resource_lock(&bench_resource);
+			kernel_notify(&deadlock, 0U, KERNEL_NOTIFY_INCREMENT);
+			bench_start = bench_cycles();
+			kernel_resource_unlock(&bench_resource);
+		}
+		break;
+	case BENCH_MESSAGE_LATENCY:
+		for (i = 0U; i < BENCH_SAMPLES; i++) {
+			uint32_t sent = bench_cycles();
+
+			(void)ring_buffer_push(&bench_ring, (const uint8_t*)&sent, sizeof(sent));
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static void bench_report(void)
+{
+	uint32_t metric;
+	uint32_t average_sum = 0U;
+
+	printf("\r\n%-20s %8s %8s %8s %8s %10s\r\n", "rhealstone", "samples", "min", "avg", "max", "avg_ns");
+	for (metric = 0U; metric < BENCH_METRICS; metric++) {
+		bench_stats_type* stats = &bench_stats[metric];
+		uint32_t average = (stats->count != 0U) ? (stats->sum / stats->count) : 0U;
+
+		average_sum += average;
+		printf("%-20s %8lu %8lu %8lu %8lu %10lu\r\n",
+			bench_metric_names[metric],
+			(unsigned long)stats->count,
+			(unsigned long)stats->min,
+			(unsigned long)average,
+			(unsigned long)stats->max,
+			(unsigned long)(((uint64_t)average * 1000000000U) / BENCH_SYSTEM_CLOCK));
+	}
+	printf("%-20s %8lu per second\r\n\r\n",
+		"rhealstones",
+		(unsigned long)((average_sum != 0U) ? (BENCH_SYSTEM_CLOCK / average_sum) : 0U));
+
+	printf("config,clock_hz=%lu,priority_max=%lu,time_slice_ticks=%lu\r\n",
+		(unsigned long)BENCH_SYSTEM_CLOCK,
+		(unsigned long)KERNEL_PRIORITY_MAX,
+		(unsigned long)KERNEL_TIME_SLICE_TICKS);
+	printf("csv,metric,samples,min_cycles,avg_cycles,max_cycles\r\n");
+	for (metric = 0U; metric < BENCH_METRICS; metric++) {
+		bench_stats_type* stats = &bench_stats[metric];
+
+		printf("csv,%s,%lu,%lu,%lu,%lu\r\n",
+			bench_metric_names[metric],
+			(unsigned long)stats->count,
+			(unsigned long)stats->min,
+			(unsigned long)((stats->count != 0U) ? (stats->sum / stats->count) : 0U),
+			(unsigned long)stats->max);
+	}
+}
+
+uint32_t driver_stack[512];
+tcb_type driver;
+void main_driver(void)
+{
+	uint32_t metric;
+
+	for (metric = 0U; metric < BENCH_METRICS; metric++) {
+		bench_run((bench_metric_type)metric);
+	}
+	bench_report();
+
+	while (1) {
+		kernel_tcb_block(KERNEL_WAIT_FOREVER);
+	}
+}
+
+int main(void)
+{
+	bench_initialize();
+	kernel_initialize();
+	systick_initialize();
+
+	kernel_semaphore_initialize(&bench_semaphore, 0U);
+	kernel_resource_initialize(&bench_resource, BENCH_PRIORITY_HIGH);
+	ring_buffer_initialize(&bench_ring, bench_ring_memory, sizeof(bench_ring_memory));
+
+	NVIC_SetPriority(EXTI0_IRQn, 1U);
+	NVIC_EnableIRQ(EXTI0_IRQn);
+
+	kernel_tcb_start_argument(
+		&switch_a,
+		BENCH_PRIORITY_SWITCH,
+		(tcb_type_handler)&main_switch,
+		&switch_b,
+		switch_a_stack,
+		sizeof(switch_a_stack));
+
+	kernel_tcb_start_argument(
+		&switch_b,
+		BENCH_PRIORITY_SWITCH,
+		(tcb_type_handler)&main_switch,
+		&switch_a,
+		switch_b_stack,
+		sizeof(switch_b_stack));
+
+	kernel_tcb_start(
+		&preempt,
+		BENCH_PRIORITY_HIGH,
+		&main_preempt,
+		preempt_stack,
+		sizeof(preempt_stack));
+
+	kernel_tcb_start(
+		&shuffle,
+		BENCH_PRIORITY_HIGH,
+		&main_shuffle,
+		shuffle_stack,
+		sizeof(shuffle_stack));
+
+	kernel_tcb_start(
+		&deadlock,
+		BENCH_PRIORITY_HIGH,
+		&main_deadlock,
+		deadlock_stack,
+		sizeof(deadlock_stack));
+
+	kernel_tcb_start(
+		&message,
+		BENCH_PRIORITY_HIGH,
+		&main_message,
+		message_stack,
+		sizeof(message_stack));
+
+	kernel_tcb_start(
+		&driver,
+		BENCH_PRIORITY_DRIVER,
+		&main_driver,
+		driver_stack,
+		sizeof(driver_stack));
+
+	kernel_run();
+}
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include "stm32f407xx.h"
+#include "bench.h"
+#include "ring_buffer.h"
+
+/* Throughput of the lock free ring buffer against a queue that protects every access with a critical section.
+ * Runs straight from main() without the kernel, the producer and consumer alternate in chunks so the buffer never
+ * fills up. Each row moves the same number of bytes and reports bytes per second at the core clock.
+ */
+#define BENCH_BUFFER_SIZE	256U
+#define BENCH_CHUNK			64U
+#define BENCH_BYTES			(64U * 1024U)
+
+/* Baseline: the same ring logic, but every push and pop runs with interrupts disabled */
+typedef struct {
+	uint8_t buffer[BENCH_BUFFER_SIZE];
+	uint32_t head;
+	uint32_t tail;
+} locked_queue_type;
+
+static uint32_t locked_queue_push(locked_queue_type* me, uint8_t data)
+{
+	uint32_t pushed = 0U;
+
+	__disable_irq();
+	if ((me->head - me->tail) < BENCH_BUFFER_SIZE) {
+		me->buffer[me->head & (BENCH_BUFFER_SIZE - 1U)] = data;
+		me->head++;
+		pushed = 1U;
+	}
+	__enable_irq();
+
+	return pushed;
+}
+
+static uint32_t locked_queue_pop(locked_queue_type* me, uint8_t* data)
+{
+	uint32_t popped = 0U;
+
+	__disable_irq();
+	if (me->head != me->tail) {
+		*data = me->buffer[me->tail & (BENCH_BUFFER_SIZE - 1U)];
+		me->tail++;
+		popped = 1U;
+	}
+	__enable_irq();
+
+	return popped;
+}
+
+static locked_queue_type locked_queue;
+static ring_buffer_type ring;
+static uint8_t ring_memory[BENCH_BUFFER_SIZE];
+static uint8_t chunk[BENCH_CHUNK];
+static volatile uint8_t sink;
+
+static void bench_report(const char* name, uint32_t cycles)
+{
+	/* bytes/s = bytes * clock / cycles, done in 64 bit so the product can't overflow */
+	uint64_t bytes_per_second = ((uint64_t)BENCH_BYTES * BENCH_SYSTEM_CLOCK) / cycles;
+
+	printf("%s,%lu,%lu,%lu\r\n",
+		name,
+		(unsigned long)BENCH_BYTES,
+		(unsigned long)cycles,
+		(unsigned long)bytes_per_second);
+}
+
+int main(void)
+{
+	uint32_t sent;
+	uint32_t i;
+	uint32_t start;
+	uint8_t byte;
+
+	bench_initialize();
+	ring_buffer_initialize(&ring, ring_memory, sizeof(ring_memory));
+
+	printf("queue,bytes,cycles,bytes_per_second\r\n");
+
+	/* One byte at a time through the critical section queue, the way an ISR usually feeds a driver queue */
+	start = bench_cycles();
+	for (sent = 0U; sent < BENCH_BYTES; sent += BENCH_CHUNK) {
+		for (i = 0U; i < BENCH_CHUNK; i++) {
+			(void)locked_queue_push(&locked_queue, (uint8_t)i);
+		}
+		for (i = 0U; i < BENCH_CHUNK; i++) {
+			(void)locked_queue_pop(&locked_queue, &byte);
+			sink = byte;
+		}
+	}
+	bench_report("locked_byte", bench_cycles() - start);
+
+	/* One byte at a time through the lock free ring buffer */
+	start = bench_cycles();
+	for (sent = 0U; sent < BENCH_BYTES; sent += BENCH_CHUNK) {
+		for (i = 0U; i < BENCH_CHUNK; i++) {
+			byte = (uint8_t)i;
+			(void)ring_buffer_push(&ring, &byte, 1U);
+		}
+		for (i = 0U; i < BENCH_CHUNK; i++) {
+			(void)ring_buffer_pop(&ring, &byte, 1U);
+			sink = byte;
+		}
+	}
+	bench_report("lockfree_byte", bench_cycles() - start);
+
+	/* Whole chunks through the lock free ring buffer */
+	start = bench_cycles();
+	for (sent = 0U; sent < BENCH_BYTES; sent += BENCH_CHUNK) {
+		(void)ring_buffer_push(&ring, chunk, BENCH_CHUNK);
+		(void)ring_buffer_pop(&ring, chunk, BENCH_CHUNK);
+	}
+	bench_report("lockfree_bulk", bench_cycles() - start);
+
+	/* Zero copy spans, the producer fills the buffer memory directly and the consumer reads it in place */
+	start = bench_cycles();
+	for (sent = 0U; sent < BENCH_BYTES; sent += BENCH_CHUNK) {
+		uint8_t* write_span;
+		const uint8_t* read_span;
+		uint32_t length;
+
+		length = ring_buffer_write_span(&ring, &write_span);
+		length = (length < BENCH_CHUNK) ? length : BENCH_CHUNK;
+		for (i = 0U; i < length; i++) {
+			write_span[i] = (uint8_t)i;
+		}
+		ring_buffer_write_commit(&ring, length);
+
+		length = ring_buffer_read_span(&ring, &read_span);
+		for (i = 0U; i < length; i++) {
+			sink = read_span[i];
+		}
+		ring_buffer_read_release(&ring, length);
+	}
+	bench_report("lockfree_span", bench_cycles() - start);
+
+	while (1) {}
+}
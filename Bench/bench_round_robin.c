@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include "stm32f407xx.h"
+#include "bench.h"
+#include "kernel.h"
+#include "kernel_bitmap.h"
+#include "systick.h"
+
+/* Round robin scheduler benchmark.
+ * Build once per thread count, e.g. -DBENCH_THREAD_COUNT=1, 8 and 32.
+ *
+ * The driver thread runs at the highest priority (BENCH_THREAD_COUNT) and the subject threads take priorities
+ * 1 to BENCH_THREAD_COUNT - 1. Every subject except the lowest one blocks itself forever on its first run, which leaves
+ * only the driver and subject 1 ready with all the blocked threads sitting in between them in the rotation.
+ * This is the worst case for a scheduler that walks the tcbs one slot at a time.
+ * With 32 threads that is 33 tcbs counting the idle thread. kernel_tcb_start() takes any number of them, a thread
+ * 	only needs its priority to fit in KERNEL_PRIORITY_MAX.
+ */
+#ifndef BENCH_THREAD_COUNT
+#define BENCH_THREAD_COUNT	8U
+#endif
+
+#if (BENCH_THREAD_COUNT < 1) || (BENCH_THREAD_COUNT > 32)
+#error "BENCH_THREAD_COUNT must be between 1 and 32"
+#endif
+
+/* The driver runs at priority BENCH_THREAD_COUNT, a thread above KERNEL_PRIORITY_MAX would never be made ready */
+#if BENCH_THREAD_COUNT > KERNEL_PRIORITY_MAX
+#error "BENCH_THREAD_COUNT can't be above KERNEL_PRIORITY_MAX"
+#endif
+
+#define BENCH_ITERATIONS	1000U
+
+uint32_t subject_stacks[BENCH_THREAD_COUNT][40];
+tcb_type subjects[BENCH_THREAD_COUNT];
+void main_subject_spin(void)
+{
+	while (1) {}
+}
+
+void main_subject_blocked(void)
+{
+	while (1) {
+		kernel_tcb_block(KERNEL_WAIT_FOREVER);
+	}
+}
+
+uint32_t driver_stack[512];
+tcb_type driver;
+void main_driver(void)
+{
+	uint32_t i;
+	uint32_t start;
+	uint32_t elapsed;
+
+	/* Give every subject thread one tick to run and settle in to its ready or blocked state */
+	if (BENCH_THREAD_COUNT > 1U) {
+		kernel_tcb_block(1U);
+	}
+
+	/* Call the scheduler back to back from inside a critical section so no context switch can happen.
+	 * Each call pends PendSV, so clear the pending bit afterwards and let the priority based scheduler
+	 * point next_thread back at the driver thread before interrupts are enabled again.
+	 */
+	__disable_irq();
+	start = bench_cycles();
+	for (i = 0; i < BENCH_ITERATIONS; i++) {
+		kernel_scheduler_round_robin();
+	}
+	elapsed = bench_cycles() - start;
+	SCB->ICSR = SCB_ICSR_PENDSVCLR_Msk;
+	kernel_scheduler_priority_based();
+	__enable_irq();
+
+	printf("bench,threads,ready,cycles_per_pick\r\n");
+	printf("round_robin,%u,%u,%lu\r\n",
+		(unsigned)BENCH_THREAD_COUNT,
+		(BENCH_THREAD_COUNT > 1U) ? 2U : 1U,
+		(unsigned long)(elapsed / BENCH_ITERATIONS));
+
+	while (1) {
+		kernel_tcb_block(KERNEL_WAIT_FOREVER);
+	}
+}
+
+int main(void)
+{
+	uint32_t i;
+
+	bench_initialize();
+	kernel_initialize();
+	systick_initialize();
+
+	for (i = 1U; i < BENCH_THREAD_COUNT; i++) {
+		kernel_tcb_start(
+			&subjects[i],
+			(uint8_t)i,
+			(i == 1U) ? &main_subject_spin : &main_subject_blocked,
+			subject_stacks[i],
+			sizeof(subject_stacks[i]));
+	}
+
+	kernel_tcb_start(
+		&driver,
+		BENCH_THREAD_COUNT,
+		&main_driver,
+		driver_stack,
+		sizeof(driver_stack));
+
+	kernel_run();
+}
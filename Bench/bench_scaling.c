@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include "stm32f407xx.h"
+#include "bench.h"
+#include "kernel.h"
+#include "kernel_bitmap.h"
+#include "kernel_critical.h"
+#include "kernel_notify.h"
+#include "systick.h"
+
+/* Scaling of the kernel hot paths with the number of threads and the share of them that is delayed.
+ * Prints one csv line per configuration with the cycles of one kernel_scheduler_priority_based() call, one
+ * 	kernel_tcb_permit() call and one PendSV_Handler run, so any path that walks the threads shows up as a slope.
+ *
+ * Threads can't be removed from the kernel, so every configuration runs in a fresh boot: the index of the next
+ * 	configuration is kept in an RTC backup register, which survives NVIC_SystemReset(). After the last one the
+ * 	register is cleared, so the next reset starts the sweep over.
+ * Subjects are spread over priorities 1 to KERNEL_PRIORITY_MAX - 1 (sharing them once there are more subjects than
+ * 	priorities), the driver runs above all of them at KERNEL_PRIORITY_MAX.
+ */
+#define BENCH_SUBJECTS_MAX	64U
+#define BENCH_ITERATIONS	1000U
+#define BENCH_MAGIC			0x5CA1AB1EU
+
+#if KERNEL_PRIORITY_MAX < 2
+#error "bench_scaling.c needs at least two priorities"
+#endif
+
+static const uint32_t bench_thread_counts[] = {1U, 2U, 4U, 8U, 16U, 32U, 64U};
+static const uint32_t bench_delayed_percents[] = {0U, 25U, 50U, 75U, 100U};
+
+#define BENCH_THREAD_STEPS	(sizeof(bench_thread_counts) / sizeof(bench_thread_counts[0]))
+#define BENCH_DELAYED_STEPS	(sizeof(bench_delayed_percents) / sizeof(bench_delayed_percents[0]))
+#define BENCH_CONFIGS		(BENCH_THREAD_STEPS * BENCH_DELAYED_STEPS)
+
+static uint32_t bench_threads;
+static uint32_t bench_delayed;
+static volatile uint32_t bench_blocked;
+static volatile uint32_t bench_spinning;
+
+uint32_t subject_stacks[BENCH_SUBJECTS_MAX][64];
+tcb_type subjects[BENCH_SUBJECTS_MAX];
+
+/* The last bench_delayed subjects park on the delayed list with a timeout that never runs out during the test, the
+ * 	rest stay ready and spin, but never get the CPU once the driver runs. The ready ones check in and sleep a tick at
+ * 	a time until every subject has checked in. Once the first of them spins the ones below it never run again, but
+ * 	the tick still moves them from the delayed list back on to their ready lists.
+ */
+void main_subject(void* argument)
+{
+	uint32_t primask;
+
+	if ((uintptr_t)argument >= (bench_threads - bench_delayed)) {
+		primask = kernel_critical_enter();
+		bench_blocked++;
+		kernel_critical_exit(primask);
+
+		while (1) {
+			(void)kernel_notify_wait(0xFFFFFFFFU, (uint32_t*)0U, BENCH_TIMEOUT_PARKED);
+		}
+	}
+
+	primask = kernel_critical_enter();
+	bench_spinning++;
+	kernel_critical_exit(primask);
+
+	while ((bench_blocked < bench_delayed) || (bench_spinning < (bench_threads - bench_delayed))) {
+		kernel_tcb_block(1U);
+	}
+
+	while (1) {}
+}
+
+uint32_t driver_stack[512];
+tcb_type driver;
+void main_driver(void)
+{
+	uint32_t primask;
+	uint32_t config = RTC->BKP0R;
+	uint32_t scheduler;
+	uint32_t permit;
+	uint32_t pendsv;
+	uint32_t start;
+	uint32_t systick_ctrl;
+	uint32_t i;
+
+	/* Wait until every subject has checked in, then two more ticks for the last one tick delays of the ready subjects
+	 * 	to run out, so they are all back on their ready lists and only the parked ones are on the delayed list
+	 */
+	while ((bench_blocked < bench_delayed) || (bench_spinning < (bench_threads - bench_delayed))) {
+		kernel_tcb_block(1U);
+	}
+	kernel_tcb_block(2U);
+
+	primask = kernel_critical_enter();
+
+	start = bench_cycles();
+	for (i = 0U; i < BENCH_ITERATIONS; i++) {
+		kernel_scheduler_priority_based();
+	}
+	scheduler = bench_cycles() - start;
+
+	/* The delayed timeouts are far too long to run out here, so every call walks the same list */
+	start = bench_cycles();
+	for (i = 0U; i < BENCH_ITERATIONS; i++) {
+		kernel_tcb_permit();
+	}
+	permit = bench_cycles() - start;
+
+	SCB->ICSR = SCB_ICSR_PENDSVCLR_Msk;
+
+	/* PendSV needs interrupts on, so the Systick is stopped instead of masked: a tick inside the loop would walk the
+	 * 	delayed subjects and charge that to the switch. Losing those ticks doesn't matter, the board resets next.
+	 */
+	systick_ctrl = SysTick->CTRL;
+	SysTick->CTRL = systick_ctrl & ~(SysTick_CTRL_ENABLE_Msk | SysTick_CTRL_TICKINT_Msk);
+	SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+	kernel_critical_exit(primask);
+
+	/* The driver is both the current and the next thread, so a manually pended PendSV saves and restores it in full
+	 * 	and comes straight back here. This includes exception entry and exit.
+	 */
+	start = bench_cycles();
+	for (i = 0U; i < BENCH_ITERATIONS; i++) {
+		SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+		__DSB();
+		__ISB();
+	}
+	pendsv = bench_cycles() - start;
+
+	SysTick->CTRL = systick_ctrl;
+
+	printf("%lu,%lu,%lu,%lu,%lu\r\n",
+		(unsigned long)bench_threads,
+		(unsigned long)bench_delayed_percents[config % BENCH_DELAYED_STEPS],
+		(unsigned long)(scheduler / BENCH_ITERATIONS),
+		(unsigned long)(permit / BENCH_ITERATIONS),
+		(unsigned long)(pendsv / BENCH_ITERATIONS));
+
+	/* Wait for the line to leave the UART before resetting in to the next configuration */
+	while ((USART2->SR & USART_SR_TC) == 0U) {}
+
+	config++;
+	if (config < BENCH_CONFIGS) {
+		RTC->BKP0R = config;
+		NVIC_SystemReset();
+	}
+
+	RTC->BKP1R = 0U;
+	printf("done\r\n");
+
+	while (1) {
+		kernel_tcb_block(KERNEL_WAIT_FOREVER);
+	}
+}
+
+int main(void)
+{
+	uint32_t config;
+	uint32_t i;
+
+	bench_initialize();
+	kernel_initialize();
+	systick_initialize();
+
+	/* The backup registers are write protected until the backup domain access bit is set */
+	RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+	PWR->CR |= PWR_CR_DBP;
+
+	if (RTC->BKP1R != BENCH_MAGIC) {
+		RTC->BKP1R = BENCH_MAGIC;
+		RTC->BKP0R = 0U;
+		printf("threads,delayed_percent,scheduler_cycles,permit_cycles,pendsv_cycles\r\n");
+	}
+
+	config = RTC->BKP0R;
+	bench_threads = bench_thread_counts[config / BENCH_DELAYED_STEPS];
+	bench_delayed = (bench_threads * bench_delayed_percents[config % BENCH_DELAYED_STEPS]) / 100U;
+
+	for (i = 0U; i < bench_threads; i++) {
+		kernel_tcb_start_argument(
+			&subjects[i],
+			(uint8_t)(1U + (i % (KERNEL_PRIORITY_MAX - 1U))),
+			(tcb_type_handler)&main_subject,
+			(void*)(uintptr_t)i,
+			subject_stacks[i],
+			sizeof(subject_stacks[i]));
+	}
+
+	kernel_tcb_start(
+		&driver,
+		KERNEL_PRIORITY_MAX,
+		&main_driver,
+		driver_stack,
+		sizeof(driver_stack));
+
+	kernel_run();
+}
@@ -0,0 +1,357 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "kernel.h"
+#include "kernel_bitmap.h"
+#include "kernel_critical.h"
+#include "kernel_notify.h"
+#include "systick.h"
+#ifndef KERNEL_PORT_POSIX
+#include "bench.h"
+#endif
+
+/* Synthetic task set stress test.
+ * For every total utilization from STRESS_UTILIZATION_FIRST to STRESS_UTILIZATION_LAST percent, a set of
+ * 	STRESS_THREADS periodic threads is generated with UUniFast, so the utilization is split over the threads without
+ * 	bias. Periods are log uniform between STRESS_PERIOD_MIN and STRESS_PERIOD_MAX ticks, deadlines equal periods and
+ * 	priorities are rate monotonic. Each job burns its budget with a calibrated busy loop, so preemption doesn't
+ * 	count as execution time.
+ * The generator only uses integers. Nothing in the project turns the FPU on or saves its registers on a context
+ * 	switch, so the first floating point instruction would fault on the board.
+ *
+ * Every round prints one line per thread with its response times and deadline misses, and a summary line with the
+ * 	scheduler overhead: the part of the round that was neither job execution nor left over for the background thread.
+ * The code only uses the kernel, critical section, notification and systick APIs and no registers, so the same
+ * 	file can also be built for a host port of the kernel.
+ */
+#ifndef STRESS_THREADS
+#define STRESS_THREADS				8U
+#endif
+#ifndef STRESS_UTILIZATION_FIRST
+#define STRESS_UTILIZATION_FIRST	50U		/* percent */
+#endif
+#ifndef STRESS_UTILIZATION_LAST
+#define STRESS_UTILIZATION_LAST		100U
+#endif
+#ifndef STRESS_UTILIZATION_STEP
+#define STRESS_UTILIZATION_STEP		5U
+#endif
+#ifndef STRESS_PERIOD_MIN
+#define STRESS_PERIOD_MIN			10U		/* ticks */
+#endif
+#ifndef STRESS_PERIOD_MAX
+#define STRESS_PERIOD_MAX			200U
+#endif
+#ifndef STRESS_ROUND_TICKS
+#define STRESS_ROUND_TICKS			5000U
+#endif
+#ifndef STRESS_SEED
+#define STRESS_SEED					12345U
+#endif
+
+#define STRESS_CALIBRATION_LOOPS	100000U
+#define STRESS_RANDOM_ONE			(1UL << 24)		/* stress_random() is uniform below this */
+#define STRESS_PPM					1000000U
+
+#if (STRESS_THREADS + 1U) > KERNEL_PRIORITY_MAX
+#error "every stress thread needs its own priority above the background thread"
+#endif
+
+typedef struct {
+	uint32_t period;			/* ticks, also the relative deadline */
+	uint32_t budget;			/* cycles of busy work per job */
+	uint32_t utilization;		/* per mille, rounded from the generated value */
+	uint8_t priority;
+	uint32_t jobs;
+	uint32_t misses;
+	uint64_t response_sum;		/* cycles */
+	uint64_t response_max;
+	uint64_t executed;			/* cycles of busy work done */
+} stress_task_type;
+
+static stress_task_type stress_tasks[STRESS_THREADS];
+static volatile uint64_t stress_start;		/* tick the round starts on */
+static volatile uint64_t stress_stop;		/* no job is released from this tick on */
+static volatile uint32_t stress_active;		/* threads still inside the round */
+static volatile uint32_t stress_sink;
+static uint32_t stress_loops_per_kilocycle;
+static uint32_t stress_seed;
+
+uint32_t stress_stacks[STRESS_THREADS][256];
+tcb_type stress_threads[STRESS_THREADS];
+
+/* Uniform in [0, STRESS_RANDOM_ONE) */
+static uint32_t stress_random(void)
+{
+	stress_seed = (stress_seed * 1664525U) + 1013904223U;
+	return stress_seed >> 8;
+}
+
+/* Distributed like u^(1 / count) for a uniform u, which is what UUniFast draws: both have the distribution function
+ * 	x^count on [0, 1), so the largest of count uniform draws does it without a root.
+ */
+static uint32_t stress_random_root(uint32_t count)
+{
+	uint32_t largest = 0U;
+	uint32_t i;
+
+	for (i = 0U; i < count; i++) {
+		uint32_t value = stress_random();
+
+		if (value > largest) {
+			largest = value;
+		}
+	}
+
+	return largest;
+}
+
+/* Log uniform period in ticks, meaning a density proportional to 1 / period, by rejection: a period drawn uniformly
+ * 	is kept with probability STRESS_PERIOD_MIN / period. About one draw in six is kept with the default range.
+ */
+static uint32_t stress_random_period(void)
+{
+	while (1) {
+		uint32_t period = STRESS_PERIOD_MIN + (stress_random() % (STRESS_PERIOD_MAX - STRESS_PERIOD_MIN + 1U));
+
+		if ((stress_random() % period) < STRESS_PERIOD_MIN) {
+			return period;
+		}
+	}
+}
+
+static void stress_work(uint32_t loops)
+{
+	uint32_t i;
+
+	for (i = 0U; i < loops; i++) {
+		stress_sink = stress_sink + i;
+	}
+}
+
+/* Measure how many busy loop iterations fit in 1000 cycles.
+ * Runs in the background thread before the first round, when every stress thread is still waiting to be started,
+ * 	so only the tick interrupt gets in the way.
+ */
+static void stress_calibrate(void)
+{
+	uint64_t start = systick_cycle_count();
+	uint64_t cycles;
+
+	stress_work(STRESS_CALIBRATION_LOOPS);
+	cycles = systick_cycle_count() - start;
+
+	stress_loops_per_kilocycle = (uint32_t)(((uint64_t)STRESS_CALIBRATION_LOOPS * 1000U) / cycles);
+}
+
+/* UUniFast: split the utilization over the threads, then draw the periods and give rate monotonic priorities */
+static void stress_generate(uint32_t utilization_percent)
+{
+	uint32_t remaining = utilization_percent * (STRESS_PPM / 100U);	/* parts per million */
+	uint32_t i;
+	uint32_t j;
+
+	for (i = 0U; i < STRESS_THREADS; i++) {
+		stress_task_type* task = &stress_tasks[i];
+		uint32_t utilization = remaining;
+
+		if ((i + 1U) < STRESS_THREADS) {
+			uint32_t next = (uint32_t)(((uint64_t)remaining * stress_random_root(STRESS_THREADS - 1U - i))
+				/ STRESS_RANDOM_ONE);
+
+			utilization = remaining - next;
+			remaining = next;
+		}
+
+		task->period = stress_random_period();
+		task->budget = (uint32_t)(((uint64_t)utilization * task->period * SYSTICK_CYCLES_PER_TICK) / STRESS_PPM);
+		task->utilization = (utilization + 500U) / 1000U;
+		task->jobs = 0U;
+		task->misses = 0U;
+		task->response_sum = 0U;
+		task->response_max = 0U;
+		task->executed = 0U;
+	}
+
+	/* Shorter period gets the higher priority, ties go to the lower index. The background thread keeps priority 1. */
+	for (i = 0U; i < STRESS_THREADS; i++) {
+		uint32_t rank = 0U;
+
+		for (j = 0U; j < STRESS_THREADS; j++) {
+			if ((stress_tasks[j].period < stress_tasks[i].period)
+				|| ((stress_tasks[j].period == stress_tasks[i].period) && (j < i))) {
+				rank++;
+			}
+		}
+		stress_tasks[i].priority = (uint8_t)(STRESS_THREADS + 1U - rank);
+	}
+}
+
+/* Body of every stress thread, the argument is its index in stress_tasks[] */
+void main_stress(void* argument)
+{
+	uint32_t primask;
+	stress_task_type* task = &stress_tasks[(uintptr_t)argument];
+
+	while (1) {
+		uint64_t release;
+
+		(void)kernel_notify_wait(0xFFFFFFFFU, (uint32_t*)0U, KERNEL_WAIT_FOREVER);
+
+		for (release = stress_start; release < stress_stop; release += task->period) {
+			uint64_t now = systick_tick_count();
+			uint64_t finish;
+			uint64_t response;
+
+			/* Sleeping for n ticks wakes up exactly on tick now + n. A late job starts right away instead. */
+			if (release > now) {
+				kernel_tcb_block((uint32_t)(release - now));
+			}
+
+			stress_work((uint32_t)(((uint64_t)task->budget * stress_loops_per_kilocycle) / 1000U));
+
+			finish = systick_cycle_count();
+			response = finish - (release * SYSTICK_CYCLES_PER_TICK);
+
+			task->jobs++;
+			task->executed += task->budget;
+			task->response_sum += response;
+			if (response > task->response_max) {
+				task->response_max = response;
+			}
+			if (response > ((uint64_t)task->period * SYSTICK_CYCLES_PER_TICK)) {
+				task->misses++;
+			}
+		}
+
+		primask = kernel_critical_enter();
+		stress_active--;
+		kernel_critical_exit(primask);
+	}
+}
+
+static void stress_round(uint32_t utilization_percent)
+{
+	uint32_t primask;
+	uint64_t background = 0U;
+	uint64_t executed = 0U;
+	uint64_t round_start;
+	uint64_t round_cycles;
+	uint32_t jobs = 0U;
+	uint32_t misses = 0U;
+	uint32_t i;
+
+	stress_generate(utilization_percent);
+
+	/* The threads are all blocked in kernel_notify_wait(), so this only changes the priority they wake up with */
+	primask = kernel_critical_enter();
+	for (i = 0U; i < STRESS_THREADS; i++) {
+		kernel_tcb_set_priority(&stress_threads[i], stress_tasks[i].priority);
+	}
+	kernel_critical_exit(primask);
+
+	stress_active = STRESS_THREADS;
+	stress_start = systick_tick_count() + 2U;
+	stress_stop = stress_start + STRESS_ROUND_TICKS;
+
+	for (i = 0U; i < STRESS_THREADS; i++) {
+		kernel_notify(&stress_threads[i], 0U, KERNEL_NOTIFY_INCREMENT);
+	}
+
+	/* Whatever this lowest priority thread gets while the round runs is spare capacity.
+	 * The round starts on its first release, even when an overloaded set keeps this thread from seeing it.
+	 */
+	while (systick_tick_count() < stress_start) {}
+	round_start = stress_start * SYSTICK_CYCLES_PER_TICK;
+	while (stress_active != 0U) {
+		stress_work(1000U);
+		background += 1000U;
+	}
+	round_cycles = systick_cycle_count() - round_start;
+	background = (background * 1000U) / stress_loops_per_kilocycle;
+
+	for (i = 0U; i < STRESS_THREADS; i++) {
+		stress_task_type* task = &stress_tasks[i];
+
+		printf("task,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\r\n",
+			(unsigned long)utilization_percent,
+			(unsigned long)i,
+			(unsigned long)task->period,
+			(unsigned long)task->budget,
+			(unsigned long)task->utilization,
+			(unsigned long)task->priority,
+			(unsigned long)task->jobs,
+			(unsigned long)task->misses,
+			(unsigned long)((task->jobs != 0U) ? (task->response_sum / task->jobs) : 0U),
+			(unsigned long)task->response_max);
+
+		jobs += task->jobs;
+		misses += task->misses;
+		executed += task->executed;
+	}
+
+	/* Overhead is what is left of the round after the jobs and the background thread, clamped at 0 since both are
+	 * 	only as accurate as the calibration
+	 */
+	printf("round,%lu,%lu,%lu,%lu,%lu\r\n",
+		(unsigned long)utilization_percent,
+		(unsigned long)jobs,
+		(unsigned long)misses,
+		(unsigned long)((executed * 1000U) / round_cycles),
+		(unsigned long)(((executed + background) < round_cycles)
+			? (((round_cycles - executed - background) * 1000U) / round_cycles) : 0U));
+}
+
+uint32_t background_stack[512];
+tcb_type background;
+void main_background(void)
+{
+	uint32_t utilization;
+
+	printf("task,utilization,thread,period_ticks,budget_cycles,utilization_permille,priority,jobs,misses,"
+		"response_avg_cycles,response_max_cycles\r\n");
+	printf("round,utilization,jobs,misses,executed_permille,overhead_permille\r\n");
+
+	stress_calibrate();
+
+	stress_seed = STRESS_SEED;
+	for (utilization = STRESS_UTILIZATION_FIRST; utilization <= STRESS_UTILIZATION_LAST;
+		utilization += STRESS_UTILIZATION_STEP) {
+		stress_round(utilization);
+	}
+
+	printf("done\r\n");
+
+	while (1) {
+		kernel_tcb_block(KERNEL_WAIT_FOREVER);
+	}
+}
+
+int main(void)
+{
+	uint32_t i;
+
+#ifndef KERNEL_PORT_POSIX
+	bench_initialize();
+#endif
+	kernel_initialize();
+	systick_initialize();
+
+	for (i = 0U; i < STRESS_THREADS; i++) {
+		kernel_tcb_start_argument(
+			&stress_threads[i],
+			(uint8_t)(i + 2U),
+			(tcb_type_handler)&main_stress,
+			(void*)(uintptr_t)i,
+			stress_stacks[i],
+			sizeof(stress_stacks[i]));
+	}
+
+	kernel_tcb_start(
+		&background,
+		1U,
+		&main_background,
+		background_stack,
+		sizeof(background_stack));
+
+	kernel_run();
+}
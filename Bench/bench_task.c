@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include "stm32f407xx.h"
+#include "bench.h"
+#include "kernel.h"
+#include "kernel_critical.h"
+#include "kernel_notify.h"
+#include "kernel_task.h"
+#include "systick.h"
+
+/* Run to completion tasks against threads.
+ *
+ * latency	cycles from kernel_task_activate() in a thread to the first line of the task on every level, and from
+ * 			kernel_notify() to a higher priority thread waiting for it, which has to go through PendSV
+ * stack	peak use of the main stack and of a thread stack while one task on every level preempts the one below it,
+ * 			each with BENCH_TASK_BYTES of locals. Tasks run on the main stack with the interrupts, so the thread stack
+ * 			only takes one exception frame however deep the tasks nest. msp_reserved_bytes is _Min_Stack_Size from
+ * 			the linker script, the part of the main stack that is painted and checked.
+ */
+#define BENCH_SAMPLES		1000U
+#define BENCH_TASK_BYTES	64U
+#define BENCH_PAINT			0xDEADBEEFU
+#define BENCH_THREAD_FILL	0xBAADF00DU		/* what kernel_tcb_start() fills a fresh stack with */
+
+extern uint8_t _estack;
+extern uint8_t _Min_Stack_Size;
+
+static kernel_task_type bench_tasks[KERNEL_TASK_LEVELS];
+static kernel_task_type bench_nested[KERNEL_TASK_LEVELS];
+static volatile uint32_t bench_end;
+
+uint32_t driver_stack[512];
+tcb_type driver;
+uint32_t responder_stack[128];
+tcb_type responder;
+uint32_t victim_stack[64] __attribute__((aligned(8)));	/* so kernel_tcb_start() fills it down to the first word */
+tcb_type victim;
+
+static void bench_latency_handler(kernel_task_type* me)
+{
+	bench_end = bench_cycles();
+	(void)me;
+}
+
+/* Keeps its locals live while it activates the next level up, which preempts it right there */
+static void bench_nested_handler(kernel_task_type* me)
+{
+	volatile uint8_t locals[BENCH_TASK_BYTES];
+	uint32_t i;
+
+	for (i = 0U; i < BENCH_TASK_BYTES; i++) {
+		locals[i] = (uint8_t)i;
+	}
+
+	if (me->level < KERNEL_TASK_LEVELS) {
+		(void)kernel_task_activate(&bench_nested[me->level]);
+	}
+
+	(void)locals[0];
+}
+
+static void bench_report(const char* path, uint32_t min, uint32_t max, uint64_t sum)
+{
+	printf("%s,%lu,%lu,%lu,%lu\r\n",
+		path,
+		(unsigned long)BENCH_SAMPLES,
+		(unsigned long)min,
+		(unsigned long)(sum / BENCH_SAMPLES),
+		(unsigned long)max);
+}
+
+/* Bytes from the top of a painted region down to the deepest word that no longer holds the paint */
+static uint32_t bench_stack_used(const uint32_t* bottom, const uint32_t* top, uint32_t paint)
+{
+	const uint32_t* word = bottom;
+
+	while ((word < top) && (*word == paint)) {
+		word++;
+	}
+
+	return (uint32_t)(top - word) * sizeof(uint32_t);
+}
+
+void main_responder(void)
+{
+	while (1) {
+		(void)kernel_notify_wait(0xFFFFFFFFU, (uint32_t*)0U, KERNEL_WAIT_FOREVER);
+		bench_end = bench_cycles();
+	}
+}
+
+/* Lowest priority, so its stack holds nothing but its own frames and whatever preempts it */
+void main_victim(void)
+{
+	(void)kernel_notify_wait(0xFFFFFFFFU, (uint32_t*)0U, KERNEL_WAIT_FOREVER);
+	(void)kernel_task_activate(&bench_nested[0]);
+	kernel_notify(&driver, 0U, KERNEL_NOTIFY_INCREMENT);
+
+	while (1) {
+		(void)kernel_notify_wait(0xFFFFFFFFU, (uint32_t*)0U, KERNEL_WAIT_FOREVER);
+	}
+}
+
+void main_driver(void)
+{
+	static const char* const level_names[KERNEL_TASK_LEVELS] = {
+		"task_level_1",
+		"task_level_2",
+		"task_level_3",
+		"task_level_4"
+	};
+	uint32_t primask;
+	uint32_t* msp_bottom = (uint32_t*)((uint32_t)&_estack - (uint32_t)&_Min_Stack_Size);
+	uint32_t* msp_top;
+	uint32_t* word;
+	uint32_t level;
+	uint32_t i;
+
+	printf("path,samples,min,mean,max\r\n");
+
+	for (level = 0U; level < KERNEL_TASK_LEVELS; level++) {
+		uint32_t min = 0xFFFFFFFFU;
+		uint32_t max = 0U;
+		uint64_t sum = 0U;
+
+		for (i = 0U; i < BENCH_SAMPLES; i++) {
+			uint32_t start = bench_cycles();
+			uint32_t cycles;
+
+			/* The task preempts the driver before kernel_task_activate() even returns */
+			(void)kernel_task_activate(&bench_tasks[level]);
+			cycles = bench_end - start;
+
+			min = (cycles < min) ? cycles : min;
+			max = (cycles > max) ? cycles : max;
+			sum += cycles;
+		}
+		bench_report(level_names[level], min, max, sum);
+	}
+
+	{
+		uint32_t min = 0xFFFFFFFFU;
+		uint32_t max = 0U;
+		uint64_t sum = 0U;
+
+		for (i = 0U; i < BENCH_SAMPLES; i++) {
+			uint32_t start = bench_cycles();
+			uint32_t cycles;
+
+			kernel_notify(&responder, 0U, KERNEL_NOTIFY_INCREMENT);
+			cycles = bench_end - start;
+
+			min = (cycles < min) ? cycles : min;
+			max = (cycles > max) ? cycles : max;
+			sum += cycles;
+		}
+		bench_report("notify_thread", min, max, sum);
+	}
+
+	/* Handlers can't run while the main stack is painted, below where main() left it only they ever use it */
+	primask = kernel_critical_enter();
+	msp_top = (uint32_t*)__get_MSP();
+	for (word = msp_bottom; word < msp_top; word++) {
+		*word = BENCH_PAINT;
+	}
+	kernel_critical_exit(primask);
+
+	kernel_notify(&victim, 0U, KERNEL_NOTIFY_INCREMENT);
+	(void)kernel_notify_wait(0xFFFFFFFFU, (uint32_t*)0U, KERNEL_WAIT_FOREVER);
+
+	printf("stack,msp_peak_bytes,msp_reserved_bytes,thread_peak_bytes,thread_stack_bytes\r\n");
+	printf("stack,%lu,%lu,%lu,%lu\r\n",
+		(unsigned long)bench_stack_used(msp_bottom, msp_top, BENCH_PAINT),
+		(unsigned long)(uint32_t)&_Min_Stack_Size,
+		(unsigned long)bench_stack_used(victim_stack, &victim_stack[sizeof(victim_stack) / sizeof(victim_stack[0])], BENCH_THREAD_FILL),
+		(unsigned long)sizeof(victim_stack));
+
+	printf("done\r\n");
+
+	while (1) {
+		kernel_tcb_block(KERNEL_WAIT_FOREVER);
+	}
+}
+
+int main(void)
+{
+	uint32_t level;
+
+	bench_initialize();
+	kernel_initialize();
+	systick_initialize();
+	kernel_task_initialize();
+
+	for (level = 0U; level < KERNEL_TASK_LEVELS; level++) {
+		kernel_task_create(&bench_tasks[level], &bench_latency_handler, (uint8_t)(level + 1U));
+		kernel_task_create(&bench_nested[level], &bench_nested_handler, (uint8_t)(level + 1U));
+	}
+
+	kernel_tcb_start(
+		&victim,
+		1U,
+		&main_victim,
+		victim_stack,
+		sizeof(victim_stack));
+
+	kernel_tcb_start(
+		&driver,
+		2U,
+		&main_driver,
+		driver_stack,
+		sizeof(driver_stack));
+
+	kernel_tcb_start(
+		&responder,
+		3U,
+		&main_responder,
+		responder_stack,
+		sizeof(responder_stack));
+
+	kernel_run();
+}
@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include "stm32f407xx.h"
+#include "bench.h"
+#include "kernel_timer.h"
+
+/* Cost of one kernel_timer_tick() with 10, 100 and 1000 armed auto reload timers.
+ * Runs straight from main() without the kernel or the Systick, the wheel is stepped by hand and every step is timed
+ * 	with the DWT cycle counter. Periods are spread over all four wheel levels so the rows include the cascades, and
+ * 	the callbacks run from the tick so their cost is in the numbers too.
+ */
+#define BENCH_TIMERS_MAX	1000U
+#define BENCH_TICKS			20000U
+
+static kernel_timer_type timers[BENCH_TIMERS_MAX];
+static volatile uint32_t expiries;
+
+static void bench_timer_callback(kernel_timer_type* timer)
+{
+	(void)timer;
+	expiries++;
+}
+
+static void bench_run(uint32_t count)
+{
+	uint32_t cycles_total = 0U;
+	uint32_t cycles_max = 0U;
+	uint32_t i;
+
+	bench_random_seed(1U);	/* every row arms the same mix of periods */
+	for (i = 0U; i < count; i++) {
+		/* Mostly short periods, with some out in level 2 and 3 */
+		uint32_t period = ((i & 3U) == 3U) ? (1U + (bench_random() % 300000U)) : (1U + (bench_random() % 2000U));
+
+		kernel_timer_create(&timers[i], &bench_timer_callback, KERNEL_TIMER_ISR_CALLBACK);
+		kernel_timer_start(&timers[i], period, period);
+	}
+
+	expiries = 0U;
+	for (i = 0U; i < BENCH_TICKS; i++) {
+		uint32_t start;
+		uint32_t cycles;
+
+		__disable_irq();
+		start = bench_cycles();
+		kernel_timer_tick();
+		cycles = bench_cycles() - start;
+		__enable_irq();
+
+		cycles_total += cycles;
+		if (cycles > cycles_max) {
+			cycles_max = cycles;
+		}
+	}
+
+	for (i = 0U; i < count; i++) {
+		kernel_timer_stop(&timers[i]);
+	}
+
+	printf("%lu,%lu,%lu,%lu,%lu\r\n",
+		(unsigned long)count,
+		(unsigned long)BENCH_TICKS,
+		(unsigned long)(cycles_total / BENCH_TICKS),
+		(unsigned long)cycles_max,
+		(unsigned long)expiries);
+}
+
+int main(void)
+{
+	bench_initialize();
+
+	printf("timers,ticks,avg_cycles,max_cycles,expiries\r\n");
+
+	bench_run(10U);
+	bench_run(100U);
+	bench_run(1000U);
+
+	while (1) {}
+}
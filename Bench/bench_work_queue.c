@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include "stm32f407xx.h"
+#include "bench.h"
+#include "kernel.h"
+#include "kernel_notify.h"
+#include "kernel_work_queue.h"
+#include "systick.h"
+
+/* Submit to handler latency of the deferred interrupt work queue, under increasing background load.
+ *
+ * TIM2 fires at pseudo random points in time and its handler submits one work item, the way a driver's ISR hands
+ * 	its bottom half to a worker. Two timestamps are kept per sample:
+ * 	submit_to_handler	from kernel_work_submit() taking the item to the first line of the handler
+ * 	trigger_to_handler	from the TIM2 overflow, back dated by its counter, so interrupt entry and any time spent
+ * 						with interrupts masked is included
+ *
+ * Two workers at different priorities serve the queue and both are idle at every submit, so every item must run on
+ * 	the higher one. low_worker_runs counts the samples that didn't and should stay at 0. queue_latency_max is the
+ * 	queue's own latency_max for the same run, it should match the submit_to_handler max.
+ * The load threads of bench.c run below both workers. The trigger, load and report are the same as in
+ * 	Bench/bench_irq_latency.c, so the two distributions can be compared directly.
+ */
+#define BENCH_SAMPLES		500U
+
+typedef enum {
+	BENCH_SEGMENT_SUBMIT = 0,
+	BENCH_SEGMENT_TOTAL,
+	BENCH_SEGMENTS
+} bench_segment_type;
+
+static const char* const bench_segment_names[BENCH_SEGMENTS] = {
+	"submit_to_handler",
+	"trigger_to_handler"
+};
+
+static uint32_t bench_samples[BENCH_SEGMENTS][BENCH_SAMPLES];
+static volatile uint32_t bench_count;
+static volatile uint32_t bench_trigger;
+static volatile uint32_t bench_busy;
+static uint32_t bench_low_runs;
+static kernel_work_queue_type bench_queue;
+static kernel_work_type bench_work;
+
+uint32_t worker_stacks[2][128];
+tcb_type workers[2];
+uint32_t driver_stack[512];
+tcb_type driver;
+
+static void bench_handler(kernel_work_type* work)
+{
+	uint32_t now = bench_cycles();
+	uint32_t count = bench_count;
+
+	if (count < BENCH_SAMPLES) {
+		bench_samples[BENCH_SEGMENT_SUBMIT][count] = now - work->submitted;
+		bench_samples[BENCH_SEGMENT_TOTAL][count] = now - bench_trigger;
+		if (kernel_tcb_current() != &workers[1]) {
+			bench_low_runs++;
+		}
+		bench_count = count + 1U;
+
+		if ((count + 1U) == BENCH_SAMPLES) {
+			kernel_notify(&driver, 0U, KERNEL_NOTIFY_INCREMENT);
+		}
+	}
+	bench_busy = 0U;
+}
+
+void TIM2_IRQHandler(void)
+{
+	uint32_t elapsed = bench_trigger_acknowledge();
+	uint32_t now = bench_cycles();
+
+	if (bench_busy == 0U) {
+		bench_busy = 1U;
+		bench_trigger = now - elapsed;
+		(void)kernel_work_submit(&bench_queue, &bench_work);
+	}
+}
+
+static void bench_report(uint32_t load)
+{
+	uint32_t segment;
+
+	for (segment = 0U; segment < BENCH_SEGMENTS; segment++) {
+		printf("%lu,%s,", (unsigned long)load, bench_segment_names[segment]);
+		bench_percentiles_print(bench_samples[segment], BENCH_SAMPLES);
+		printf(",%lu,%lu\r\n", (unsigned long)bench_queue.latency_max, (unsigned long)bench_low_runs);
+	}
+}
+
+void main_driver(void)
+{
+	static const uint32_t load_levels[] = {0U, 1U, 2U, 4U, 8U};
+	uint32_t level;
+
+	printf("load_threads,segment," BENCH_PERCENTILES_HEADER ",queue_latency_max,low_worker_runs\r\n");
+
+	for (level = 0U; level < (sizeof(load_levels) / sizeof(load_levels[0])); level++) {
+		bench_load_set(load_levels[level]);
+		bench_count = 0U;
+		bench_busy = 0U;
+		bench_low_runs = 0U;
+		bench_queue.latency_max = 0U;
+
+		bench_trigger_start();
+		(void)kernel_notify_wait(0xFFFFFFFFU, (uint32_t*)0U, KERNEL_WAIT_FOREVER);
+		bench_trigger_stop();
+
+		bench_report(load_levels[level]);
+	}
+
+	printf("done\r\n");
+
+	bench_load_set(0U);
+	while (1) {
+		kernel_tcb_block(KERNEL_WAIT_FOREVER);
+	}
+}
+
+int main(void)
+{
+	bench_initialize();
+	kernel_initialize();
+	systick_initialize();
+
+	kernel_work_queue_initialize(&bench_queue);
+	kernel_work_initialize(&bench_work, &bench_handler);
+
+	/* Below Systick like any driver interrupt */
+	NVIC_SetPriority(TIM2_IRQn, 1U);
+	NVIC_EnableIRQ(TIM2_IRQn);
+
+	/* The higher worker runs first and so blocks first, which leaves the lower one at the front of the wait list */
+	kernel_work_queue_start_worker(&bench_queue, &workers[1], 4U, worker_stacks[1], sizeof(worker_stacks[1]));
+	kernel_work_queue_start_worker(&bench_queue, &workers[0], 3U, worker_stacks[0], sizeof(worker_stacks[0]));
+
+	kernel_tcb_start(
+		&driver,
+		2U,
+		&main_driver,
+		driver_stack,
+		sizeof(driver_stack));
+
+	bench_load_start(1U);
+
+	kernel_run();
+}
@@ -0,0 +1,92 @@
+#ifndef ACTIVE_OBJECT_H_
+#define ACTIVE_OBJECT_H_
+
+#include <stdint.h>
+#include "kernel.h"
+
+/* Active object (AO) layer on top of the kernel.
+ * Every AO is a hierarchical state machine with its own event queue. All AOs are run by one dispatcher thread that
+ * 	always picks the highest priority AO with a queued event and dispatches that event run to completion, so the AOs
+ * 	share a single stack instead of needing one thread and one stack each.
+ * AO priorities are separate from thread priorities: 1 to AO_MAX_ACTIVE, higher number runs first, one AO per priority.
+ */
+
+#ifndef AO_MAX_ACTIVE
+#define AO_MAX_ACTIVE		32U		/* at most 32, the ready set is a single 32 bit mask */
+#endif
+#ifndef AO_MAX_SIGNALS
+#define AO_MAX_SIGNALS		32U		/* number of signals that can be published */
+#endif
+#ifndef AO_MAX_POOLS
+#define AO_MAX_POOLS		3U
+#endif
+#ifndef AO_HSM_MAX_DEPTH
+#define AO_HSM_MAX_DEPTH	8U		/* deepest state nesting supported, including the top state */
+#endif
+
+/* Reserved signals used by the state machine processor, application signals start at AO_SIGNAL_USER */
+enum {
+	AO_SIGNAL_EMPTY = 0,
+	AO_SIGNAL_ENTRY,
+	AO_SIGNAL_EXIT,
+	AO_SIGNAL_INIT,
+	AO_SIGNAL_USER
+};
+
+/* Events are usually embedded as the first member of a bigger struct carrying the parameters.
+ * Events with pool_id 0 are static (for example const events without parameters) and are never recycled.
+ */
+typedef struct {
+	uint16_t signal;
+	uint8_t pool_id;
+	volatile uint8_t ref_count;
+} ao_event_type;
+
+typedef struct ao_type ao_type;
+
+/* State handler return codes, use the AO_* macros below instead of returning these directly */
+typedef enum {
+	AO_RET_HANDLED = 0,
+	AO_RET_IGNORED,
+	AO_RET_SUPER,
+	AO_RET_TRAN
+} ao_state_result;
+
+typedef ao_state_result (*ao_state_handler)(ao_type* me, const ao_event_type* e);
+
+#define AO_HANDLED()		(AO_RET_HANDLED)
+#define AO_TRAN(target)		(((ao_type*)(me))->temp = (ao_state_handler)(target), AO_RET_TRAN)
+#define AO_SUPER(parent)	(((ao_type*)(me))->temp = (ao_state_handler)(parent), AO_RET_SUPER)
+
+struct ao_type {
+	ao_state_handler state;		/* current leaf state */
+	ao_state_handler temp;		/* target or super state returned by a handler */
+	const ao_event_type** queue;
+	uint8_t queue_length;
+	uint8_t queue_head;
+	uint8_t queue_tail;
+	uint8_t queue_count;
+	uint8_t priority;
+};
+
+/* Outermost state, every state handler chains up to it through AO_SUPER(&ao_state_top) */
+ao_state_result ao_state_top(ao_type* me, const ao_event_type* e);
+
+void ao_framework_start(tcb_type* dispatcher, uint8_t priority, void* stack_array, uint32_t stack_size);
+/* Returns KERNEL_INVALID, without starting the AO, for a priority outside 1 to AO_MAX_ACTIVE or already taken */
+kernel_status_type ao_start(
+	ao_type* me,
+	uint8_t priority,
+	ao_state_handler initial,
+	const ao_event_type** queue_storage,
+	uint8_t queue_length);
+
+void ao_pool_initialize(void* storage, uint32_t storage_size, uint16_t block_size);
+ao_event_type* ao_event_new(uint16_t size, uint16_t signal);
+
+uint32_t ao_post(ao_type* me, const ao_event_type* e);
+void ao_subscribe(ao_type* me, uint16_t signal);
+void ao_unsubscribe(ao_type* me, uint16_t signal);
+void ao_publish(const ao_event_type* e);
+
+#endif /* ACTIVE_OBJECT_H_ */
@@ -2,9 +2,49 @@
 #define KERNEL_H_
 
 #include <stdint.h>
+#ifdef KERNEL_PORT_POSIX
+#include "kernel_port.h"
+#endif
+
+/* Default time slice in Systick ticks given to a thread that shares its priority with other ready threads.
+ * Can be changed per thread with kernel_tcb_set_quantum(). A quantum of 0 turns time slicing off for that thread.
+ */
+#ifndef KERNEL_TIME_SLICE_TICKS
+#define KERNEL_TIME_SLICE_TICKS	10U
+#endif
+
+/* Latency tracing for benchmarks. Build the whole project with -DKERNEL_TRACE=1 to timestamp every context switch
+ * 	the schedulers pend in kernel_trace_pendsv_set, using the same clock as kernel_trace_timestamp().
+ */
+#ifndef KERNEL_TRACE
+#define KERNEL_TRACE		0
+#endif
+
+/* Per job execution budgets. Build the whole project with -DKERNEL_BUDGET=1 to time every job of every thread with
+ * 	the DWT cycle counter at each context switch, see kernel_budget.h.
+ */
+#ifndef KERNEL_BUDGET
+#define KERNEL_BUDGET		0
+#endif
+
+/* A timeout of 0 never runs out, the thread stays blocked until something wakes it up */
+#define KERNEL_WAIT_FOREVER	0U
+
+/* Status codes returned by kernel functions that can fail or time out */
+typedef enum {
+	KERNEL_OK = 0,
+	KERNEL_TIMEOUT,
+	KERNEL_REJECTED,		/* admission control refused the thread, see kernel_admission.h */
+	KERNEL_INVALID			/* parameters that can never work */
+} kernel_status_type;
+
+/* Thread states */
+#define KERNEL_TCB_READY	0U
+#define KERNEL_TCB_BLOCKED	1U
 
 /* Struct definition for a thread (TCB) */
-typedef struct {
+typedef struct tcb_type tcb_type;
+struct tcb_type {
 	/* sp is of type void* because it allows the RTOS to manage the sp without
 	 * 	assuming the data type on the stack. Remember, void* is a generic pointer type
 	 * 	which means it can point to any data type.
@@ -14,9 +54,64 @@ typedef struct {
 	/* Timeout variable to keep track of how long a thread should stay blocked */
 	uint32_t timeout;
 
-	/* Thread priority property */
+	/* Threads of the same priority are kept in a circular doubly linked ready list.
+	 * While a thread is blocked the same links are reused for the delayed list instead.
+	 */
+	tcb_type* next;
+	tcb_type* prev;
+
+	/* Wait list of the kernel object the thread is blocked on, NULL when the thread is only delayed.
+	 * The wait list links are separate from next/prev because a waiting thread with a timeout is on both lists.
+	 */
+	tcb_type** wait_list;
+	tcb_type* wait_next;
+	tcb_type* wait_prev;
+
+	/* Generic wait parameters and result, what they mean depends on the kernel object being waited on */
+	uint32_t wait_mask;
+	uint32_t wait_value;
+	uint8_t wait_options;
+	uint8_t wait_status;
+
+	/* Direct to task notification. notify_waiter is the thread's own one entry wait list, it only holds the thread
+	 * 	itself while it is blocked in kernel_notify_wait().
+	 */
+	volatile uint32_t notify_value;
+	tcb_type* notify_waiter;
+	volatile uint8_t notify_pending;
+
+	/* Time slice length in ticks, and the ticks left in the current slice */
+	uint32_t quantum;
+	uint32_t slice;
+
+	/* Thread priority property. base_priority is the one it was given, priority is where it runs right now, which is
+	 * 	higher while it holds a kernel_resource and lower while its job is demoted for overrunning its budget.
+	 */
 	uint8_t priority;
-}tcb_type;
+	uint8_t base_priority;
+
+	/* Number of kernel_resource locks the thread holds */
+	uint8_t locks;
+
+	/* KERNEL_TCB_READY while the thread is on a ready list, KERNEL_TCB_BLOCKED while it is on the delayed list */
+	volatile uint8_t state;
+
+#if KERNEL_BUDGET
+	/* Execution time of the current job, a job runs from a wake up until the thread blocks again. In cycles. */
+	uint32_t budget;			/* allowed cycles per job, 0 only measures */
+	uint32_t budget_used;		/* cycles of the current job up to the last switch out */
+	uint32_t budget_start;		/* cycle count of the last switch in */
+	uint32_t budget_max;		/* longest job so far */
+	uint32_t budget_overruns;
+	uint8_t budget_policy;
+	uint8_t budget_state;
+#endif
+
+#ifdef KERNEL_PORT_POSIX
+	/* The pthread behind the tcb on the Linux host port, see Port/posix */
+	kernel_port_tcb_type port;
+#endif
+};
 
 /* Function pointer needed to pass in the address of the respective threads */
 typedef void (*tcb_type_handler)();
@@ -26,7 +121,15 @@ void kernel_scheduler_priority_based(void);
 void kernel_scheduler_round_robin(void);
 void kernel_run(void);
 void kernel_tcb_block(uint32_t blocking_timeout);
+kernel_status_type kernel_tcb_wait(tcb_type** wait_list, uint32_t timeout);
+void kernel_tcb_wake(tcb_type* tcb, kernel_status_type status);
+tcb_type* kernel_tcb_current(void);
+void kernel_tcb_set_priority(tcb_type* tcb, uint8_t priority);
+void kernel_tcb_set_base_priority(tcb_type* tcb, uint8_t priority);
+void kernel_tcb_restore_priority(tcb_type* tcb);
 void kernel_tcb_permit(void);
+void kernel_tcb_time_slice(void);
+void kernel_tcb_set_quantum(tcb_type* me, uint32_t quantum);
 
 /* Function to start a thread, the void* stack_array variable is the address to the start of the stack in memory */
 void kernel_tcb_start(
@@ -36,4 +139,23 @@ void kernel_tcb_start(
 	void* stack_array,
 	uint32_t stack_size);
 
+/* Same as kernel_tcb_start(), but the thread receives argument as the first parameter of tcb_handler */
+void kernel_tcb_start_argument(
+	tcb_type* me,
+	uint8_t priority,
+	tcb_type_handler tcb_handler,
+	void* argument,
+	void* stack_array,
+	uint32_t stack_size);
+
+#if KERNEL_BUDGET
+void kernel_tcb_suspend(tcb_type* tcb);
+void kernel_tcb_budget_check(void);
+#endif
+
+#if KERNEL_TRACE
+extern volatile uint32_t kernel_trace_pendsv_set;
+uint32_t kernel_trace_timestamp(void);
+#endif
+
 #endif /* KERNEL_H_ */
@@ -0,0 +1,93 @@
+#ifndef KERNEL_ADMISSION_H_
+#define KERNEL_ADMISSION_H_
+
+#include <stdint.h>
+#include "kernel.h"
+#include "kernel_bitmap.h"
+
+/* Admission control for periodic threads.
+ * A thread started with kernel_admission_start() declares its period, relative deadline, worst case execution time
+ * 	and blocking time. It is only started if every admitted thread, including itself, still meets its deadline, and
+ * 	kernel_admission_start() returns KERNEL_REJECTED otherwise, so an overload shows up when it's configured instead
+ * 	of as deadline misses later on.
+ *
+ * With KERNEL_ADMISSION_PRIORITY_AUTO the kernel picks the priority: deadline monotonic among all automatic threads,
+ * 	shortest deadline highest, inside the band from KERNEL_ADMISSION_PRIORITY_LOWEST to
+ * 	KERNEL_ADMISSION_PRIORITY_HIGHEST. Already running automatic threads are moved when a new one ranks above them.
+ *
+ * Only threads started through here take part, threads started with kernel_tcb_start() are not accounted for.
+ * Deadlines can't be longer than the period.
+ */
+
+/* The test kernel_admission_start() runs.
+ * Response time: exact worst case response time analysis for fixed priorities, with the Systick Handler and two
+ * 	context switches per job as overhead and equal priority peers counted as interference. Works for any priorities.
+ * Utilization: the hyperbolic bound, the product of (U + 1) over all threads must stay at or below 2. Far cheaper, but
+ * 	only sufficient when priorities are rate monotonic, deadlines equal periods and nothing blocks. It is used while
+ * 	every admitted thread has an automatic priority, a deadline equal to its period and no blocking time. A set with
+ * 	a manual priority, a shorter deadline or a blocking time in it falls back to the response time test.
+ */
+#define KERNEL_ADMISSION_TEST_RESPONSE_TIME	0
+#define KERNEL_ADMISSION_TEST_UTILIZATION	1
+
+#ifndef KERNEL_ADMISSION_TEST
+#define KERNEL_ADMISSION_TEST				KERNEL_ADMISSION_TEST_RESPONSE_TIME
+#endif
+
+/* Overheads in core clock cycles, take them from Bench/bench_scaling.c and Bench/bench_rhealstone.c */
+#ifndef KERNEL_ADMISSION_TICK_OVERHEAD
+#define KERNEL_ADMISSION_TICK_OVERHEAD		0U
+#endif
+#ifndef KERNEL_ADMISSION_SWITCH_OVERHEAD
+#define KERNEL_ADMISSION_SWITCH_OVERHEAD	0U
+#endif
+
+#ifndef KERNEL_ADMISSION_PRIORITY_HIGHEST
+#define KERNEL_ADMISSION_PRIORITY_HIGHEST	KERNEL_PRIORITY_MAX
+#endif
+#ifndef KERNEL_ADMISSION_PRIORITY_LOWEST
+#define KERNEL_ADMISSION_PRIORITY_LOWEST	1U
+#endif
+
+#if (KERNEL_ADMISSION_PRIORITY_LOWEST < 1) || (KERNEL_ADMISSION_PRIORITY_HIGHEST > KERNEL_PRIORITY_MAX) \
+	|| (KERNEL_ADMISSION_PRIORITY_LOWEST > KERNEL_ADMISSION_PRIORITY_HIGHEST)
+#error "the automatic priority band must lie between 1 and KERNEL_PRIORITY_MAX"
+#endif
+
+#define KERNEL_ADMISSION_PRIORITY_AUTO		0U
+
+typedef struct kernel_admission_type kernel_admission_type;
+struct kernel_admission_type {
+	tcb_type* tcb;
+	uint32_t period;			/* ticks */
+	uint32_t deadline;			/* ticks, at most the period */
+	uint32_t wcet;				/* cycles */
+	uint32_t blocking;			/* cycles a lower priority thread can hold it up, for example kernel_resource_blocking() */
+	uint32_t response;			/* worst case response time in cycles as of the last admission, 0 if the utilization bound admitted it */
+	uint8_t automatic;			/* the priority is picked by the kernel */
+	uint8_t priority;
+	uint8_t candidate;			/* priority while a new thread is being tested */
+	kernel_admission_type* next;
+};
+
+void kernel_admission_initialize(
+	kernel_admission_type* me,
+	uint32_t period,
+	uint32_t deadline,
+	uint32_t wcet,
+	uint32_t blocking);
+
+/* Same as kernel_tcb_start_argument() after the test, pass KERNEL_ADMISSION_PRIORITY_AUTO to get a priority picked.
+ * Returns KERNEL_OK once the thread is started, KERNEL_REJECTED if the set would no longer be schedulable and
+ * 	KERNEL_INVALID for impossible parameters or when the automatic band has no priority left.
+ */
+kernel_status_type kernel_admission_start(
+	kernel_admission_type* me,
+	tcb_type* tcb,
+	uint8_t priority,
+	tcb_type_handler tcb_handler,
+	void* argument,
+	void* stack_array,
+	uint32_t stack_size);
+
+#endif /* KERNEL_ADMISSION_H_ */
@@ -0,0 +1,108 @@
+#ifndef KERNEL_BITMAP_H_
+#define KERNEL_BITMAP_H_
+
+#include <stdint.h>
+
+/* Two level priority bitmap.
+ * Priority p (1 to KERNEL_PRIORITY_MAX) owns bit (p - 1), which lives in word[(p - 1) / 32] at bit (p - 1) % 32.
+ * Bit g of the group mask is set whenever word[g] has any bit set, so the highest set priority is found with one
+ * __builtin_clz on the group mask and a second one on the word it points at, no matter how many levels are configured.
+ * Priority 0 is reserved for the idle thread and never has a bit.
+ *
+ * Everything is static inline because these run inside the scheduler on every tick.
+ */
+
+#ifndef KERNEL_PRIORITY_MAX
+#define KERNEL_PRIORITY_MAX	32U
+#endif
+
+#if (KERNEL_PRIORITY_MAX < 1) || (KERNEL_PRIORITY_MAX > 255)
+#error "KERNEL_PRIORITY_MAX must be between 1 and 255, priority 0 is the idle thread"
+#endif
+
+#define KERNEL_PRIORITY_WORDS	((KERNEL_PRIORITY_MAX + 31U) / 32U)
+
+typedef struct {
+	uint32_t group;
+	uint32_t word[KERNEL_PRIORITY_WORDS];
+} kernel_bitmap_type;
+
+static inline void kernel_bitmap_set(kernel_bitmap_type* bitmap, uint8_t priority)
+{
+	uint32_t bit = (uint32_t)priority - 1U;
+
+	bitmap->word[bit >> 5] |= (1U << (bit & 31U));
+	bitmap->group |= (1U << (bit >> 5));
+}
+
+static inline void kernel_bitmap_clear(kernel_bitmap_type* bitmap, uint8_t priority)
+{
+	uint32_t bit = (uint32_t)priority - 1U;
+
+	bitmap->word[bit >> 5] &= ~(1U << (bit & 31U));
+
+	/* Only drop the group bit once the whole word is empty */
+	if (bitmap->word[bit >> 5] == 0U) {
+		bitmap->group &= ~(1U << (bit >> 5));
+	}
+}
+
+static inline uint32_t kernel_bitmap_empty(const kernel_bitmap_type* bitmap)
+{
+	return (bitmap->group == 0U);
+}
+
+/* Returns the highest set priority, or 0 if nothing is set. */
+static inline uint8_t kernel_bitmap_highest(const kernel_bitmap_type* bitmap)
+{
+	uint32_t group;
+
+	if (bitmap->group == 0U) {
+		return 0U;
+	}
+
+	group = 31U - (uint32_t)__builtin_clz(bitmap->group);
+	return (uint8_t)((group * 32U) + (32U - (uint32_t)__builtin_clz(bitmap->word[group])));
+}
+
+/* Returns the lowest set priority, or 0 if nothing is set. */
+static inline uint8_t kernel_bitmap_lowest(const kernel_bitmap_type* bitmap)
+{
+	uint32_t group;
+
+	if (bitmap->group == 0U) {
+		return 0U;
+	}
+
+	group = (uint32_t)__builtin_ctz(bitmap->group);
+	return (uint8_t)((group * 32U) + (uint32_t)__builtin_ctz(bitmap->word[group]) + 1U);
+}
+
+/* Returns the lowest set priority above the given one, wrapping around to the lowest set priority when nothing
+ * above it is set. Returns 0 if nothing is set. This is what the round robin scheduler rotates with.
+ */
+static inline uint8_t kernel_bitmap_next(const kernel_bitmap_type* bitmap, uint8_t priority)
+{
+	/* Bit (priority - 1) is the given priority, so the search starts at bit position "priority" */
+	uint32_t bit = priority;
+
+	if (bit < KERNEL_PRIORITY_MAX) {
+		uint32_t group = bit >> 5;
+		uint32_t word = bitmap->word[group] & (0xFFFFFFFFU << (bit & 31U));
+
+		if (word != 0U) {
+			return (uint8_t)((group * 32U) + (uint32_t)__builtin_ctz(word) + 1U);
+		}
+
+		/* Nothing left in this word, look at the groups above it. group is at most 7 so the shift is safe */
+		word = bitmap->group & (0xFFFFFFFEU << group);
+		if (word != 0U) {
+			group = (uint32_t)__builtin_ctz(word);
+			return (uint8_t)((group * 32U) + (uint32_t)__builtin_ctz(bitmap->word[group]) + 1U);
+		}
+	}
+
+	return kernel_bitmap_lowest(bitmap);
+}
+
+#endif /* KERNEL_BITMAP_H_ */
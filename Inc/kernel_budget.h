@@ -0,0 +1,78 @@
+#ifndef KERNEL_BUDGET_H_
+#define KERNEL_BUDGET_H_
+
+#include <stdint.h>
+#include "kernel.h"
+#include "kernel_bitmap.h"
+
+/* Execution budgets per job, needs the whole project built with -DKERNEL_BUDGET=1.
+ * A job is everything a thread runs from being made ready until it blocks again, so one pass of a periodic loop that
+ * 	ends in kernel_tcb_block() or a wait on a kernel object. The PendSV Handler charges the DWT cycles between
+ * 	switching a thread in and out to its current job, which includes the interrupts that hit in between.
+ *
+ * Every thread records its longest job. Once a thread has a budget, the Systick Handler checks the running job every
+ * 	tick and applies the thread's policy as soon as the job runs past it, so an overrun is caught within a tick
+ * 	instead of after the lower priority threads have already missed. A job that overruns and blocks between two ticks
+ * 	is still counted and reported when it ends, the policy then has nothing left to stop.
+ * A job that overruns while it holds a kernel_resource is reported right away, but demoting or suspending it then
+ * 	would drop it below the resource's ceiling with the resource still taken. The policy waits until the job
+ * 	releases its last resource instead, which is never later than its longest critical section.
+ *
+ * kernel_admission_type::wcet is the natural budget for threads started through admission control.
+ */
+
+typedef enum {
+	KERNEL_BUDGET_CALLBACK = 0,		/* only report it, the job keeps running at its priority */
+	KERNEL_BUDGET_DEMOTE,			/* drop to KERNEL_BUDGET_BACKGROUND_PRIORITY until the job ends */
+	KERNEL_BUDGET_SUSPEND			/* take the thread off the CPU until kernel_budget_resume() */
+} kernel_budget_policy_type;
+
+typedef enum {
+	KERNEL_BUDGET_STATE_NONE = 0,
+	KERNEL_BUDGET_STATE_OVERRUN,	/* the current job overran and was reported */
+	KERNEL_BUDGET_STATE_DEFERRED,	/* it overran holding a resource, the policy waits for the last unlock */
+	KERNEL_BUDGET_STATE_DEMOTED,
+	KERNEL_BUDGET_STATE_SUSPENDED
+} kernel_budget_state_type;
+
+/* Priority demoted jobs finish at, above the idle thread and below everything with a deadline */
+#ifndef KERNEL_BUDGET_BACKGROUND_PRIORITY
+#define KERNEL_BUDGET_BACKGROUND_PRIORITY	1U
+#endif
+
+#if (KERNEL_BUDGET_BACKGROUND_PRIORITY < 1) || (KERNEL_BUDGET_BACKGROUND_PRIORITY > KERNEL_PRIORITY_MAX)
+#error "the background priority must lie between 1 and KERNEL_PRIORITY_MAX"
+#endif
+
+/* Called on every overrun with the cycles the job has used so far, before the policy is applied.
+ * Runs from the Systick Handler, or with interrupts disabled from the thread whose job just ended, so keep it short.
+ */
+typedef void (*kernel_budget_handler)(tcb_type* tcb, uint32_t used);
+
+typedef struct {
+	uint32_t budget;				/* cycles per job, 0 when the thread is only measured */
+	uint32_t execution_max;			/* longest job so far in cycles */
+	uint32_t overruns;
+} kernel_budget_stats_type;
+
+/* Give a thread a budget in cycles per job and the policy for overruns, a budget of 0 only measures.
+ * Takes effect from the next check, it doesn't restart the running job.
+ */
+void kernel_budget_set(tcb_type* tcb, uint32_t budget, kernel_budget_policy_type policy);
+void kernel_budget_set_handler(kernel_budget_handler handler);
+
+/* Make a suspended thread ready again, its job continues with a fresh budget. Does nothing for other threads. */
+void kernel_budget_resume(tcb_type* tcb);
+
+void kernel_budget_stats(const tcb_type* tcb, kernel_budget_stats_type* stats);
+void kernel_budget_reset(tcb_type* tcb);
+
+/* Applies the policy of a thread whose job went past its budget. Only for the kernel, with interrupts disabled. */
+void kernel_budget_overrun(tcb_type* tcb, uint32_t used, uint8_t finished);
+
+/* Applies a deferred policy once the thread has released its last resource. Only for the kernel, with interrupts
+ * 	disabled, and the caller reschedules.
+ */
+void kernel_budget_release(tcb_type* tcb);
+
+#endif /* KERNEL_BUDGET_H_ */
@@ -0,0 +1,97 @@
+#ifndef KERNEL_CRITICAL_H_
+#define KERNEL_CRITICAL_H_
+
+#include <stdint.h>
+#ifdef KERNEL_PORT_POSIX
+#include "kernel_port.h"
+#else
+#include "stm32f407xx.h"
+#endif
+
+/* Critical sections that measure how long interrupts stay masked.
+ * kernel_critical_enter() masks interrupts and returns the PRIMASK it found, kernel_critical_exit() puts that PRIMASK
+ * 	back, so sections nest: an inner exit leaves interrupts masked, for example a kernel object called from a timer
+ * 	callback inside kernel_timer_tick(). Every outermost section is timed with the DWT cycle counter and the longest
+ * 	one is kept together with the function and line that entered it, so a latency budget can be checked at runtime
+ * 	with kernel_critical_stats() and started over with kernel_critical_reset().
+ * Build with -DKERNEL_CRITICAL_TRACE=0 to turn them back in to the bare instructions.
+ */
+#ifndef KERNEL_CRITICAL_TRACE
+#define KERNEL_CRITICAL_TRACE	1
+#endif
+
+typedef struct {
+	uint32_t cycles_max;		/* longest masked time seen, in core clock cycles */
+	const char* function;		/* function that entered the longest section, NULL if none was recorded yet */
+	uint32_t line;
+} kernel_critical_stats_type;
+
+void kernel_critical_stats(kernel_critical_stats_type* stats);
+void kernel_critical_reset(void);
+
+#if defined(KERNEL_PORT_POSIX)
+
+/* One process wide mutex instead of masking interrupts, its longest hold time is tracked the same way */
+#define kernel_critical_enter()			kernel_port_lock_at(__func__, __LINE__)
+#define kernel_critical_exit(primask)	kernel_port_unlock(primask)
+
+#elif KERNEL_CRITICAL_TRACE
+
+#define kernel_critical_enter()			kernel_critical_enter_at(__func__, __LINE__)
+#define kernel_critical_exit(primask)	kernel_critical_exit_at(primask)
+
+/* Written by the inline functions below and by the PendSV Handler, only while interrupts are masked */
+extern kernel_critical_stats_type kernel_critical_max;
+extern uint32_t kernel_critical_start;
+extern const char* kernel_critical_function;
+extern uint32_t kernel_critical_line;
+
+/* Entering while interrupts are already masked keeps timing the outer section */
+static inline uint32_t kernel_critical_enter_at(const char* function, uint32_t line)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+
+	if (primask == 0U) {
+		kernel_critical_start = DWT->CYCCNT;
+		kernel_critical_function = function;
+		kernel_critical_line = line;
+	}
+
+	return primask;
+}
+
+/* Only the exit of the outermost section closes the measurement and unmasks */
+static inline void kernel_critical_exit_at(uint32_t primask)
+{
+	if (primask == 0U) {
+		uint32_t cycles = DWT->CYCCNT - kernel_critical_start;
+
+		if (cycles > kernel_critical_max.cycles_max) {
+			kernel_critical_max.cycles_max = cycles;
+			kernel_critical_max.function = kernel_critical_function;
+			kernel_critical_max.line = kernel_critical_line;
+		}
+	}
+
+	__set_PRIMASK(primask);
+}
+
+#else
+
+#define kernel_critical_enter()			kernel_critical_mask()
+#define kernel_critical_exit(primask)	__set_PRIMASK(primask)
+
+static inline uint32_t kernel_critical_mask(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+
+	return primask;
+}
+
+#endif /* KERNEL_CRITICAL_TRACE */
+
+#endif /* KERNEL_CRITICAL_H_ */
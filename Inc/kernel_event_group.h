@@ -0,0 +1,26 @@
+#ifndef KERNEL_EVENT_GROUP_H_
+#define KERNEL_EVENT_GROUP_H_
+
+#include <stdint.h>
+#include "kernel.h"
+
+/* Wait options, can be OR'd together.
+ * By default a waiter is satisfied once ANY of its bits are set.
+ */
+#define KERNEL_EVENT_GROUP_WAIT_ANY		0x00U
+#define KERNEL_EVENT_GROUP_WAIT_ALL		0x01U	/* Only satisfied once ALL of the bits are set */
+#define KERNEL_EVENT_GROUP_CLEAR_ON_EXIT	0x02U	/* Clear the waited on bits when the wait is satisfied */
+
+/* 32 bit event flag group. Threads block on it with a mask of bits and ISRs or other threads set bits to wake them. */
+typedef struct {
+	volatile uint32_t flags;
+	tcb_type* waiters;
+} kernel_event_group_type;
+
+void kernel_event_group_initialize(kernel_event_group_type* me);
+uint32_t kernel_event_group_set(kernel_event_group_type* me, uint32_t bits);
+uint32_t kernel_event_group_clear(kernel_event_group_type* me, uint32_t bits);
+uint32_t kernel_event_group_get(kernel_event_group_type* me);
+uint32_t kernel_event_group_wait(kernel_event_group_type* me, uint32_t bits, uint8_t options, uint32_t timeout);
+
+#endif /* KERNEL_EVENT_GROUP_H_ */
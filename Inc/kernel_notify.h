@@ -0,0 +1,17 @@
+#ifndef KERNEL_NOTIFY_H_
+#define KERNEL_NOTIFY_H_
+
+#include <stdint.h>
+#include "kernel.h"
+
+/* How kernel_notify() updates the notification value of the receiving thread */
+typedef enum {
+	KERNEL_NOTIFY_SET_BITS = 0,	/* OR the value in, use it like a light weight event group */
+	KERNEL_NOTIFY_INCREMENT,	/* Add one and ignore the value, use it like a light weight counting semaphore */
+	KERNEL_NOTIFY_OVERWRITE		/* Replace the value, use it like a one entry mailbox */
+} kernel_notify_mode_type;
+
+void kernel_notify(tcb_type* tcb, uint32_t value, kernel_notify_mode_type mode);
+kernel_status_type kernel_notify_wait(uint32_t clear_on_exit, uint32_t* value, uint32_t timeout);
+
+#endif /* KERNEL_NOTIFY_H_ */
@@ -0,0 +1,46 @@
+#ifndef KERNEL_RESOURCE_H_
+#define KERNEL_RESOURCE_H_
+
+#include <stdint.h>
+#include "kernel.h"
+
+/* Shared resource locked with the immediate priority ceiling protocol (the thread based form of the
+ * 	Stack Resource Policy).
+ * The ceiling is assigned statically: it must be at least the priority of the highest priority thread that ever
+ * 	locks the resource. Locking immediately raises the running thread to the ceiling, so no other thread that uses the
+ * 	resource can run until it is unlocked. That gives:
+ * - A thread is blocked at most once, for at most the longest critical section of a lower priority thread on a
+ * 	resource with a ceiling at or above its own priority, and only before it starts running.
+ * - No chained blocking and no deadlock, since a lock can never be found taken.
+ * The worst case blocking of every thread can therefore be computed from the ceilings and the hold times, see
+ * 	kernel_resource_blocking().
+ *
+ * Rules: locks must be released in the reverse order they were taken, and a thread must never block while it holds one.
+ */
+typedef struct {
+	uint8_t ceiling;
+	uint8_t saved_priority;		/* priority of the owner before it locked the resource, for nested locks */
+	uint32_t saved_slice;		/* time slice the owner had left before it locked the resource */
+	tcb_type* owner;
+	uint32_t locked_at;			/* DWT cycle count when the resource was locked */
+	uint32_t hold_max;			/* longest time the resource has been held in cycles, needs the DWT cycle counter enabled */
+} kernel_resource_type;
+
+/* One resource a thread locks, for kernel_resource_blocking(). Describe every thread and resource pair once. */
+typedef struct {
+	const kernel_resource_type* resource;
+	uint8_t priority;			/* base priority of the thread that locks it */
+	uint32_t hold;				/* longest the thread holds it in cycles, 0 takes the resource's measured hold_max */
+} kernel_resource_use_type;
+
+void kernel_resource_initialize(kernel_resource_type* me, uint8_t ceiling);
+void kernel_resource_lock(kernel_resource_type* me);
+void kernel_resource_unlock(kernel_resource_type* me);
+
+/* Worst case blocking in cycles of a thread at priority, to pass as the blocking time to kernel_admission_initialize()
+ * 	or the blocking_us column of Tools/rta.py. It is the longest hold by a lower priority thread of any resource with
+ * 	a ceiling at or above priority, since a thread can be blocked only once.
+ */
+uint32_t kernel_resource_blocking(const kernel_resource_use_type* uses, uint32_t count, uint8_t priority);
+
+#endif /* KERNEL_RESOURCE_H_ */
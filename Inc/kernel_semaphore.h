@@ -0,0 +1,17 @@
+#ifndef KERNEL_SEMAPHORE_H_
+#define KERNEL_SEMAPHORE_H_
+
+#include <stdint.h>
+#include "kernel.h"
+
+/* Counting semaphore */
+typedef struct {
+	volatile uint32_t count;
+	tcb_type* waiters;
+} kernel_semaphore_type;
+
+void kernel_semaphore_initialize(kernel_semaphore_type* me, uint32_t count);
+void kernel_semaphore_give(kernel_semaphore_type* me);
+kernel_status_type kernel_semaphore_take(kernel_semaphore_type* me, uint32_t timeout);
+
+#endif /* KERNEL_SEMAPHORE_H_ */
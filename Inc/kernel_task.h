@@ -0,0 +1,38 @@
+#ifndef KERNEL_TASK_H_
+#define KERNEL_TASK_H_
+
+#include <stdint.h>
+
+/* Run to completion tasks on a single shared stack.
+ * A task is just a function that is activated, runs to the end and returns, it can never block.
+ * Every task level is backed by an otherwise unused NVIC interrupt. Activating a task queues it on its level and pends
+ * 	that interrupt, so the NVIC does all the preemption: a higher level task preempts a lower one exactly like a
+ * 	nested interrupt, and every task runs on the main stack the interrupts already use. A task costs a few bytes of RAM
+ * 	instead of a tcb and a stack.
+ * Threads run on the process stack, so a task that preempts a thread only leaves one exception frame on the thread's
+ * 	stack. The worst case of all nested task levels and interrupts is paid once, on the main stack, which has to be
+ * 	sized for it with _Min_Stack_Size in the linker script. See Bench/bench_task.c for both numbers.
+ *
+ * Tasks run in handler mode, so they preempt every thread and sit just below Systick. From a task only call the
+ * 	kernel functions that are safe from an ISR (notify, semaphore give, event group set, work submit, AO post).
+ *
+ * The levels use the CAN2 interrupt vectors, so an application using tasks can't use CAN2 interrupts.
+ */
+#define KERNEL_TASK_LEVELS	4U
+
+typedef struct kernel_task_type kernel_task_type;
+
+typedef void (*kernel_task_handler)(kernel_task_type* me);
+
+struct kernel_task_type {
+	kernel_task_handler handler;
+	kernel_task_type* next;
+	uint8_t level;				/* 1 to KERNEL_TASK_LEVELS, higher level preempts lower */
+	volatile uint8_t pending;
+};
+
+void kernel_task_initialize(void);
+void kernel_task_create(kernel_task_type* me, kernel_task_handler handler, uint8_t level);
+uint32_t kernel_task_activate(kernel_task_type* me);
+
+#endif /* KERNEL_TASK_H_ */
@@ -0,0 +1,47 @@
+#ifndef KERNEL_TIMER_H_
+#define KERNEL_TIMER_H_
+
+#include <stdint.h>
+#include "kernel.h"
+
+/* Software timers on a hierarchical timing wheel driven from the Systick Handler.
+ * Level 0 has one slot per tick, and every level above it has slots 64 times as wide. A timer is put straight in to
+ * 	the level and slot its expiry falls in, so starting and stopping is O(1). Each tick only looks at one level 0 slot,
+ * 	and every 64 ticks the matching slot of the next level is cascaded down a level.
+ * Four levels cover 2^24 ticks (over 4 hours at 1 ms), longer delays are parked in the top level and re-filed when
+ * 	they cascade.
+ */
+#define KERNEL_TIMER_LEVELS			4U
+#define KERNEL_TIMER_SLOT_BITS		6U
+#define KERNEL_TIMER_SLOTS			(1U << KERNEL_TIMER_SLOT_BITS)
+
+/* Timer options */
+#define KERNEL_TIMER_THREAD_CALLBACK	0x00U	/* run the callback in the timer service thread (default) */
+#define KERNEL_TIMER_ISR_CALLBACK		0x01U	/* run the callback straight from the Systick Handler */
+
+typedef struct kernel_timer_type kernel_timer_type;
+
+typedef void (*kernel_timer_handler)(kernel_timer_type* timer);
+
+/* A timer is usually embedded in a bigger struct so the callback can get back to its context */
+struct kernel_timer_type {
+	kernel_timer_type* next;
+	kernel_timer_type* prev;
+	kernel_timer_type** list;		/* wheel slot the timer is on, NULL when it is not armed */
+	kernel_timer_type* expired_next;	/* link on the service thread's expired queue */
+	kernel_timer_handler callback;
+	uint32_t expires;				/* absolute tick the timer expires on */
+	uint32_t period;				/* reload value in ticks, 0 for a one shot timer */
+	uint8_t options;
+	uint8_t queued;					/* on the expired queue */
+	uint8_t pending;				/* a thread callback is owed, cleared by kernel_timer_stop() */
+};
+
+void kernel_timer_create(kernel_timer_type* me, kernel_timer_handler callback, uint8_t options);
+void kernel_timer_start(kernel_timer_type* me, uint32_t delay, uint32_t period);
+void kernel_timer_stop(kernel_timer_type* me);
+uint32_t kernel_timer_active(const kernel_timer_type* me);
+void kernel_timer_tick(void);
+void kernel_timer_service_start(tcb_type* service, uint8_t priority, void* stack_array, uint32_t stack_size);
+
+#endif /* KERNEL_TIMER_H_ */
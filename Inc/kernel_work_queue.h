@@ -0,0 +1,40 @@
+#ifndef KERNEL_WORK_QUEUE_H_
+#define KERNEL_WORK_QUEUE_H_
+
+#include <stdint.h>
+#include "kernel.h"
+
+typedef struct kernel_work_type kernel_work_type;
+
+typedef void (*kernel_work_handler)(kernel_work_type* work);
+
+/* A unit of deferred work. Usually embedded in a driver's own struct so the handler can get back to it.
+ * pending is set while the item sits in a queue, submitting it again in that window is coalesced in to one run.
+ */
+struct kernel_work_type {
+	kernel_work_handler handler;
+	kernel_work_type* next;
+	uint32_t submitted;			/* DWT cycle count when it was queued, used for the latency statistics */
+	volatile uint8_t pending;
+};
+
+/* FIFO of work items drained by one or more worker threads */
+typedef struct {
+	kernel_work_type* head;
+	kernel_work_type* tail;
+	tcb_type* workers;			/* wait list of idle worker threads */
+	uint32_t latency_max;		/* worst case cycles from submit to the handler starting, needs the DWT cycle counter enabled */
+	uint32_t coalesced;			/* number of submits that found the item already pending */
+} kernel_work_queue_type;
+
+void kernel_work_initialize(kernel_work_type* work, kernel_work_handler handler);
+void kernel_work_queue_initialize(kernel_work_queue_type* me);
+void kernel_work_queue_start_worker(
+	kernel_work_queue_type* me,
+	tcb_type* worker,
+	uint8_t priority,
+	void* stack_array,
+	uint32_t stack_size);
+uint32_t kernel_work_submit(kernel_work_queue_type* me, kernel_work_type* work);
+
+#endif /* KERNEL_WORK_QUEUE_H_ */
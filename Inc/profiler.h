@@ -0,0 +1,51 @@
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <stdint.h>
+#include "kernel.h"
+
+/* Statistical PC sampling profiler.
+ * TIM7 interrupts at PROFILER_RATE_HZ and records the PC the interrupt returns to and the running thread's tcb.
+ * profiler_dump() prints the samples so Tools/profiler_symbolize.py can turn them in to a flat profile and a per
+ * 	thread breakdown using the symbol table of the ELF file.
+ * Build with -DPROFILER_ENABLE=1 to use it. With the default of 0 the whole module compiles away and the calls below
+ * 	turn in to nothing, so they can stay in the application.
+ */
+#ifndef PROFILER_ENABLE
+#define PROFILER_ENABLE			0
+#endif
+
+/* Sampling rate. Overhead is roughly rate * 60 cycles, about 0.4% at the default. Avoid multiples of the 1 kHz tick
+ * 	so the samples don't lock on to the same point of every tick.
+ */
+#ifndef PROFILER_RATE_HZ
+#define PROFILER_RATE_HZ		997U
+#endif
+
+/* Samples kept in RAM, 8 bytes each. The buffer is a ring: once it is full every new sample overwrites the oldest one,
+ * 	so a dump at any point of a long run shows the latest PROFILER_SAMPLES / PROFILER_RATE_HZ seconds of it.
+ */
+#ifndef PROFILER_SAMPLES
+#define PROFILER_SAMPLES		1024U
+#endif
+
+typedef struct {
+	uint32_t pc;
+	tcb_type* tcb;				/* NULL before the kernel runs */
+} profiler_sample_type;
+
+#if PROFILER_ENABLE
+
+void profiler_start(void);
+void profiler_stop(void);
+void profiler_dump(void);
+
+#else
+
+#define profiler_start()		((void)0)
+#define profiler_stop()			((void)0)
+#define profiler_dump()			((void)0)
+
+#endif /* PROFILER_ENABLE */
+
+#endif /* PROFILER_H_ */
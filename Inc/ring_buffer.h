@@ -0,0 +1,42 @@
+#ifndef RING_BUFFER_H_
+#define RING_BUFFER_H_
+
+#include <stdint.h>
+#include "kernel.h"
+
+/* Notification bit the producer uses to wake a consumer sleeping in ring_buffer_wait() */
+#ifndef RING_BUFFER_NOTIFY_BIT
+#define RING_BUFFER_NOTIFY_BIT	(1U << 31)
+#endif
+
+/* Lock free single producer / single consumer byte ring buffer.
+ * head is only ever written by the producer and tail only by the consumer, so as long as there is exactly one of each
+ * 	(for example one ISR and one thread) no critical section is needed to move data.
+ * Both indexes run freely and wrap at 2^32, head - tail is always the number of used bytes. The buffer size is a power
+ * 	of two so an index is turned in to a buffer position with a single AND.
+ */
+typedef struct {
+	uint8_t* buffer;
+	uint32_t mask;
+	volatile uint32_t head;
+	volatile uint32_t tail;
+	tcb_type* volatile consumer;
+	volatile uint8_t consumer_waiting;
+} ring_buffer_type;
+
+void ring_buffer_initialize(ring_buffer_type* me, uint8_t* buffer, uint32_t size);
+uint32_t ring_buffer_count(const ring_buffer_type* me);
+uint32_t ring_buffer_space(const ring_buffer_type* me);
+
+/* Producer side */
+uint32_t ring_buffer_push(ring_buffer_type* me, const uint8_t* data, uint32_t length);
+uint32_t ring_buffer_write_span(ring_buffer_type* me, uint8_t** span);
+void ring_buffer_write_commit(ring_buffer_type* me, uint32_t length);
+
+/* Consumer side */
+uint32_t ring_buffer_pop(ring_buffer_type* me, uint8_t* data, uint32_t length);
+uint32_t ring_buffer_read_span(ring_buffer_type* me, const uint8_t** span);
+void ring_buffer_read_release(ring_buffer_type* me, uint32_t length);
+kernel_status_type ring_buffer_wait(ring_buffer_type* me, uint32_t timeout);
+
+#endif /* RING_BUFFER_H_ */
@@ -1,7 +1,31 @@
 #ifndef SYSTICK_H_
 #define SYSTICK_H_
 
+#include <stdint.h>
+
+#define SYSTICK_SYSTEM_CLOCK		16000000U	/* 16 MHz */
+#define SYSTICK_TICKS_PER_SECOND	1000U
+#define SYSTICK_CYCLES_PER_TICK		(SYSTICK_SYSTEM_CLOCK / SYSTICK_TICKS_PER_SECOND)
+#define SYSTICK_CYCLES_PER_US		(SYSTICK_SYSTEM_CLOCK / 1000000U)
+
+/* Starting estimate of the cost of blocking and being switched back in, in cycles: how late a thread runs again after
+ * 	the tick boundary it slept until, through the Systick Handler, the scheduler and PendSV. systick_delay() only
+ * 	sleeps when the delay is longer than a tick plus this cost, anything shorter is cheaper to spin.
+ * The first delay that sleeps measures the real cost on the running system and every later one uses that, so this
+ * 	only has to be a safe upper bound. Set it from the task switch and interrupt latency of Bench/bench_rhealstone.c
+ * 	to make the first delay exact as well.
+ */
+#ifndef SYSTICK_DELAY_SWITCH_CYCLES
+#define SYSTICK_DELAY_SWITCH_CYCLES	1000U
+#endif
+
 void systick_initialize(void);
 void systick_delay_ms(uint32_t delay);
+void systick_delay_cycles(uint32_t cycles);
+void systick_delay_us(uint32_t delay);
+void systick_delay(uint32_t delay);
+uint64_t systick_tick_count(void);
+uint64_t systick_cycle_count(void);
+uint64_t systick_time_us(void);
 
 #endif /* SYSTICK_H_ */
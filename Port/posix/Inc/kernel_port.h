@@ -0,0 +1,45 @@
+#ifndef KERNEL_PORT_H_
+#define KERNEL_PORT_H_
+
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+
+/* Linux host port of the kernel API.
+ * Every thread is a pthread with a SCHED_FIFO priority that follows its kernel priority, blocking maps to condition
+ * 	variables and clock_nanosleep() with absolute deadlines on the tick grid, and the critical section is one process
+ * 	wide mutex. Application code, the notification, semaphore, event group and timer sources and Bench/bench_stress.c
+ * 	build unmodified with -DKERNEL_PORT_POSIX and Port/posix/Inc ahead of Inc on the include path.
+ *
+ * Linux does the scheduling, so unlike on the board threads of different priorities run in parallel on every core.
+ * Build with -DKERNEL_PORT_CPU=n to pin the whole process to core n, which brings back strict priority preemption
+ * 	as long as SCHED_FIFO is allowed (root or CAP_SYS_NICE). Without it the port falls back to normal threads.
+ */
+#ifndef KERNEL_PORT_CPU
+#define KERNEL_PORT_CPU		-1
+#endif
+
+/* Host side of a tcb, kept inside tcb_type so kernel objects can keep linking tcbs the way they do on the board */
+typedef struct {
+	pthread_t thread;
+	pthread_cond_t wake;		/* signalled by kernel_tcb_wake(), waited on with the kernel mutex */
+	void (*handler)();
+	void* argument;
+	uint8_t created;			/* the pthread exists, threads started before kernel_run() wait for it */
+} kernel_port_tcb_type;
+
+/* Critical section, the same nesting rules as kernel_critical_enter() on the board but counted per thread.
+ * kernel_port_wait() leaves it while sleeping on cond until the absolute deadline, either may be NULL.
+ */
+void kernel_port_critical_initialize(void);
+uint32_t kernel_port_lock_at(const char* function, uint32_t line);
+void kernel_port_unlock(uint32_t depth);
+void kernel_port_wait(pthread_cond_t* cond, const struct timespec* deadline);
+
+/* Absolute CLOCK_MONOTONIC time of the tick that lies the given number of ticks after the current one */
+void kernel_port_tick_deadline(uint32_t ticks, struct timespec* deadline);
+
+/* SCHED_FIFO priority a kernel priority runs at, the top one is left for the tick thread */
+int kernel_port_priority(uint8_t priority);
+
+#endif /* KERNEL_PORT_H_ */
@@ -0,0 +1,358 @@
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include "kernel.h"
+#include "kernel_critical.h"
+#include "kernel_bitmap.h"
+
+#if KERNEL_BUDGET
+#error "execution budgets are charged by the PendSV Handler of the board, the host port has none"
+#endif
+
+/* Linux host implementation of Inc/kernel.h, see kernel_port.h for the overall mapping.
+ * The tcb lists of Src/kernel.c are gone: Linux keeps the ready queues and the tick is a clock, not a list walk.
+ * 	Only the wait lists of the kernel objects are still linked through the tcbs, by the shared kernel object sources.
+ */
+
+static void* kernel_port_entry(void* argument);
+static void kernel_port_create(tcb_type* tcb);
+static void kernel_tcb_wait_remove(tcb_type* tcb);
+
+static __thread tcb_type* kernel_port_current;		/* NULL in main() and in the tick thread */
+static tcb_type* kernel_port_pending;				/* threads started before kernel_run(), linked through next */
+static uint8_t kernel_port_running;
+static uint8_t kernel_port_fifo = 1U;				/* cleared once SCHED_FIFO turned out to be not allowed */
+
+void kernel_initialize(void)
+{
+	kernel_port_critical_initialize();
+
+	/* printf() goes straight out of the UART on the board, keep lines coming out as they are written here too */
+	setvbuf(stdout, (char*)0U, _IOLBF, 0U);
+
+#if KERNEL_PORT_CPU >= 0
+	{
+		cpu_set_t cpus;
+
+		CPU_ZERO(&cpus);
+		CPU_SET(KERNEL_PORT_CPU, &cpus);
+		if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+			perror("kernel: pinning to KERNEL_PORT_CPU failed");
+		}
+	}
+#endif
+}
+
+/* Function to start the kernel.
+ * Creates the threads started so far and turns the calling thread in to the idle thread, which on Linux only has to
+ * 	stay out of the way. Like on the board it never returns.
+ */
+void kernel_run(void)
+{
+	uint32_t primask;
+	tcb_type* tcb;
+
+	primask = kernel_critical_enter();
+	kernel_port_running = 1U;
+	while (kernel_port_pending != (tcb_type*)0U) {
+		tcb = kernel_port_pending;
+		kernel_port_pending = tcb->next;
+		kernel_port_create(tcb);
+	}
+	kernel_critical_exit(primask);
+
+	while (1) {
+		pause();
+	}
+}
+
+/* Linux picks the thread to run, the schedulers only stay for the kernel objects that call them after a wake up */
+void kernel_scheduler_priority_based(void)
+{
+}
+
+void kernel_scheduler_round_robin(void)
+{
+}
+
+/* Function to start a thread, the stack memory isn't used because a pthread needs far more than the board does */
+void kernel_tcb_start(
+	tcb_type* me,
+	uint8_t priority,
+	tcb_type_handler tcb_handler,
+	void* stack_array,
+	uint32_t stack_size)
+{
+	kernel_tcb_start_argument(me, priority, tcb_handler, (void*)0U, stack_array, stack_size);
+}
+
+void kernel_tcb_start_argument(
+	tcb_type* me,
+	uint8_t priority,
+	tcb_type_handler tcb_handler,
+	void* argument,
+	void* stack_array,
+	uint32_t stack_size)
+{
+	uint32_t primask;
+	pthread_condattr_t attributes;
+
+	(void)stack_array;
+	(void)stack_size;
+
+	if ((uint32_t)priority > KERNEL_PRIORITY_MAX) {
+		return;
+	}
+
+	me->priority = priority;
+	me->base_priority = priority;
+	me->locks = 0U;
+	me->quantum = KERNEL_TIME_SLICE_TICKS;
+	me->state = KERNEL_TCB_READY;
+	me->wait_list = (tcb_type**)0U;
+	me->notify_value = 0U;
+	me->notify_waiter = (tcb_type*)0U;
+	me->notify_pending = 0U;
+	me->port.handler = tcb_handler;
+	me->port.argument = argument;
+	me->port.created = 0U;
+
+	/* Timed waits are absolute CLOCK_MONOTONIC deadlines, the same clock the ticks are counted on */
+	pthread_condattr_init(&attributes);
+	pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+	pthread_cond_init(&me->port.wake, &attributes);
+	pthread_condattr_destroy(&attributes);
+
+	primask = kernel_critical_enter();
+	if (kernel_port_running != 0U) {
+		kernel_port_create(me);
+	} else {
+		me->next = kernel_port_pending;
+		kernel_port_pending = me;
+	}
+	kernel_critical_exit(primask);
+}
+
+/* Time slicing among equal priorities is left to Linux, SCHED_FIFO runs them until they block */
+void kernel_tcb_set_quantum(tcb_type* me, uint32_t quantum)
+{
+	uint32_t primask;
+
+	primask = kernel_critical_enter();
+	me->quantum = quantum;
+	kernel_critical_exit(primask);
+}
+
+/* Function to block current thread for a specified amount of time */
+void kernel_tcb_block(uint32_t blocking_timeout)
+{
+	uint32_t primask;
+
+	primask = kernel_critical_enter();
+	(void)kernel_tcb_wait((tcb_type**)0U, blocking_timeout);
+	kernel_critical_exit(primask);
+}
+
+/* Function to block the current thread on a kernel object's wait list until it is woken up with kernel_tcb_wake()
+ * 	or the timeout runs out, with the same contract as on the board: called and returning inside a critical section.
+ * A timeout of n ticks runs out on the n-th tick boundary from now, so periodic threads stay on the tick grid.
+ * A plain delay sleeps with clock_nanosleep() outside the mutex, anything else waits on the thread's condition.
+ */
+kernel_status_type kernel_tcb_wait(tcb_type** wait_list, uint32_t timeout)
+{
+	tcb_type* tcb = kernel_port_current;
+	struct timespec deadline;
+
+	/* main() and the tick thread aren't kernel threads and must never block */
+	if (tcb == (tcb_type*)0U) {
+		return KERNEL_TIMEOUT;
+	}
+
+	tcb->timeout = timeout;
+	tcb->wait_status = KERNEL_TIMEOUT;
+	tcb->state = KERNEL_TCB_BLOCKED;
+	kernel_port_tick_deadline(timeout, &deadline);
+
+	tcb->wait_list = wait_list;
+	if (wait_list != (tcb_type**)0U) {
+		tcb->wait_prev = (tcb_type*)0U;
+		tcb->wait_next = *wait_list;
+		if (*wait_list != (tcb_type*)0U) {
+			(*wait_list)->wait_prev = tcb;
+		}
+		*wait_list = tcb;
+	}
+
+	if ((wait_list == (tcb_type**)0U) && (timeout != KERNEL_WAIT_FOREVER)) {
+		kernel_port_wait((pthread_cond_t*)0U, &deadline);
+		tcb->state = KERNEL_TCB_READY;
+	}
+
+	while (tcb->state == KERNEL_TCB_BLOCKED) {
+		if (timeout == KERNEL_WAIT_FOREVER) {
+			kernel_port_wait(&tcb->port.wake, (const struct timespec*)0U);
+		} else {
+			kernel_port_wait(&tcb->port.wake, &deadline);
+
+			/* A wake up that raced with the deadline wins, it already unlinked the thread */
+			if (tcb->state == KERNEL_TCB_BLOCKED) {
+				struct timespec now;
+
+				clock_gettime(CLOCK_MONOTONIC, &now);
+				if ((now.tv_sec > deadline.tv_sec)
+					|| ((now.tv_sec == deadline.tv_sec) && (now.tv_nsec >= deadline.tv_nsec))) {
+					kernel_tcb_wait_remove(tcb);
+					tcb->state = KERNEL_TCB_READY;
+				}
+			}
+		}
+	}
+
+	return (kernel_status_type)tcb->wait_status;
+}
+
+/* Function for kernel objects to make a waiting thread ready again.
+ * Must be called inside of a critical section.
+ */
+void kernel_tcb_wake(tcb_type* tcb, kernel_status_type status)
+{
+	tcb->wait_status = (uint8_t)status;
+
+	kernel_tcb_wait_remove(tcb);
+	tcb->state = KERNEL_TCB_READY;
+	pthread_cond_signal(&tcb->port.wake);
+}
+
+tcb_type* kernel_tcb_current(void)
+{
+	return kernel_port_current;
+}
+
+/* Function to move a thread to a different priority, takes effect right away.
+ * Must be called inside of a critical section.
+ */
+void kernel_tcb_set_priority(tcb_type* tcb, uint8_t priority)
+{
+	if ((priority == 0U) || ((uint32_t)priority > KERNEL_PRIORITY_MAX)) {
+		return;
+	}
+
+	tcb->priority = priority;
+	if ((tcb->port.created != 0U) && (kernel_port_fifo != 0U)) {
+		(void)pthread_setschedprio(tcb->port.thread, kernel_port_priority(priority));
+	}
+}
+
+/* Function to change the priority a thread was given. There are no resource ceilings or budgets on the host, so the
+ * 	thread always runs at its base priority.
+ * Must be called inside of a critical section.
+ */
+void kernel_tcb_set_base_priority(tcb_type* tcb, uint8_t priority)
+{
+	if ((priority == 0U) || ((uint32_t)priority > KERNEL_PRIORITY_MAX)) {
+		return;
+	}
+
+	tcb->base_priority = priority;
+	kernel_tcb_restore_priority(tcb);
+}
+
+void kernel_tcb_restore_priority(tcb_type* tcb)
+{
+	kernel_tcb_set_priority(tcb, tcb->base_priority);
+}
+
+/* Timeouts are absolute deadlines on the host, so there is nothing to count down every tick */
+void kernel_tcb_permit(void)
+{
+}
+
+void kernel_tcb_time_slice(void)
+{
+}
+
+/* Spread the kernel priorities over the SCHED_FIFO range below the tick thread.
+ * With more kernel priorities than Linux has levels, neighbouring priorities end up sharing one.
+ */
+int kernel_port_priority(uint8_t priority)
+{
+	int minimum = sched_get_priority_min(SCHED_FIFO);
+	int maximum = sched_get_priority_max(SCHED_FIFO) - 1;
+
+	return minimum + (int)(((uint32_t)priority * (uint32_t)(maximum - minimum)) / KERNEL_PRIORITY_MAX);
+}
+
+/* Create the pthread of a tcb, inside of a critical section */
+static void kernel_port_create(tcb_type* tcb)
+{
+	pthread_attr_t attributes;
+	struct sched_param parameters;
+	int error = EPERM;
+
+	if (kernel_port_fifo != 0U) {
+		pthread_attr_init(&attributes);
+		pthread_attr_setinheritsched(&attributes, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attributes, SCHED_FIFO);
+		parameters.sched_priority = kernel_port_priority(tcb->priority);
+		pthread_attr_setschedparam(&attributes, &parameters);
+		error = pthread_create(&tcb->port.thread, &attributes, &kernel_port_entry, tcb);
+		pthread_attr_destroy(&attributes);
+
+		if (error == EPERM) {
+			kernel_port_fifo = 0U;
+			fprintf(stderr, "kernel: SCHED_FIFO not permitted, priorities are ignored\n");
+		}
+	}
+
+	if (error == EPERM) {
+		error = pthread_create(&tcb->port.thread, (const pthread_attr_t*)0U, &kernel_port_entry, tcb);
+	}
+
+	if (error != 0) {
+		fprintf(stderr, "kernel: creating a thread failed (%d)\n", error);
+		return;
+	}
+
+	tcb->port.created = 1U;
+}
+
+static void* kernel_port_entry(void* argument)
+{
+	tcb_type* tcb = (tcb_type*)argument;
+
+	kernel_port_current = tcb;
+	tcb->port.handler(tcb->port.argument);
+
+	/* Threads never return on the board either, park it instead of tearing down a tcb that others may still link to */
+	while (1) {
+		kernel_tcb_block(KERNEL_WAIT_FOREVER);
+	}
+
+	return (void*)0U;
+}
+
+/* Unlink a thread from the wait list of the kernel object it is blocked on, if any */
+static void kernel_tcb_wait_remove(tcb_type* tcb)
+{
+	if (tcb->wait_list == (tcb_type**)0U) {
+		return;
+	}
+
+	if (tcb->wait_prev != (tcb_type*)0U) {
+		tcb->wait_prev->wait_next = tcb->wait_next;
+	} else {
+		*tcb->wait_list = tcb->wait_next;
+	}
+
+	if (tcb->wait_next != (tcb_type*)0U) {
+		tcb->wait_next->wait_prev = tcb->wait_prev;
+	}
+
+	tcb->wait_list = (tcb_type**)0U;
+}
+
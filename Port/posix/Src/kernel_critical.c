@@ -0,0 +1,127 @@
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include "kernel_critical.h"
+#include "systick.h"
+
+/* The critical section of the Linux host port: one mutex for the whole kernel.
+ * The depth is counted per thread, so a kernel object called from a timer callback that already runs inside the tick
+ * 	thread's section doesn't lock itself out. The longest hold time is tracked like the masked time on the board and
+ * 	reported in cycles of the board's clock, so the numbers stay comparable.
+ */
+
+static pthread_mutex_t kernel_critical_mutex;
+static __thread uint32_t kernel_critical_depth;
+
+/* Only touched while holding the mutex */
+static kernel_critical_stats_type kernel_critical_max;
+static struct timespec kernel_critical_start;
+static const char* kernel_critical_function;
+static uint32_t kernel_critical_line;
+
+static void kernel_critical_begin(void);
+static void kernel_critical_end(void);
+
+void kernel_port_critical_initialize(void)
+{
+	pthread_mutexattr_t attributes;
+
+	/* Priority inheritance keeps a low priority thread inside a critical section from stalling a high priority one */
+	pthread_mutexattr_init(&attributes);
+	pthread_mutexattr_setprotocol(&attributes, PTHREAD_PRIO_INHERIT);
+	pthread_mutex_init(&kernel_critical_mutex, &attributes);
+	pthread_mutexattr_destroy(&attributes);
+}
+
+/* Returns the depth before entering, which takes the place of the PRIMASK on the board: 0 for the outermost section */
+uint32_t kernel_port_lock_at(const char* function, uint32_t line)
+{
+	uint32_t depth = kernel_critical_depth++;
+
+	if (depth == 0U) {
+		pthread_mutex_lock(&kernel_critical_mutex);
+		kernel_critical_function = function;
+		kernel_critical_line = line;
+		kernel_critical_begin();
+	}
+
+	return depth;
+}
+
+void kernel_port_unlock(uint32_t depth)
+{
+	kernel_critical_depth = depth;
+	if (depth == 0U) {
+		kernel_critical_end();
+		pthread_mutex_unlock(&kernel_critical_mutex);
+	}
+}
+
+/* Leave the critical section while waiting for cond to be signalled or the deadline to pass, whichever comes first.
+ * Without a cond this is a plain absolute sleep, without a deadline the wait never times out.
+ */
+void kernel_port_wait(pthread_cond_t* cond, const struct timespec* deadline)
+{
+	const char* function = kernel_critical_function;
+	uint32_t line = kernel_critical_line;
+
+	kernel_critical_end();
+
+	if (cond == (pthread_cond_t*)0U) {
+		pthread_mutex_unlock(&kernel_critical_mutex);
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, (struct timespec*)0U) == EINTR) {}
+		pthread_mutex_lock(&kernel_critical_mutex);
+	} else if (deadline == (const struct timespec*)0U) {
+		pthread_cond_wait(cond, &kernel_critical_mutex);
+	} else {
+		(void)pthread_cond_timedwait(cond, &kernel_critical_mutex, deadline);
+	}
+
+	kernel_critical_function = function;
+	kernel_critical_line = line;
+	kernel_critical_begin();
+}
+
+void kernel_critical_stats(kernel_critical_stats_type* stats)
+{
+	uint32_t primask;
+
+	primask = kernel_critical_enter();
+	*stats = kernel_critical_max;
+	kernel_critical_exit(primask);
+}
+
+void kernel_critical_reset(void)
+{
+	uint32_t primask;
+
+	primask = kernel_critical_enter();
+	kernel_critical_max.cycles_max = 0U;
+	kernel_critical_max.function = (const char*)0U;
+	kernel_critical_max.line = 0U;
+	kernel_critical_exit(primask);
+}
+
+static void kernel_critical_begin(void)
+{
+	clock_gettime(CLOCK_MONOTONIC, &kernel_critical_start);
+}
+
+static void kernel_critical_end(void)
+{
+	struct timespec now;
+	int64_t nanoseconds;
+	uint32_t cycles;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	nanoseconds = ((int64_t)(now.tv_sec - kernel_critical_start.tv_sec) * 1000000000)
+		+ (now.tv_nsec - kernel_critical_start.tv_nsec);
+	cycles = (uint32_t)((nanoseconds * SYSTICK_CYCLES_PER_US) / 1000);
+
+	if (cycles > kernel_critical_max.cycles_max) {
+		kernel_critical_max.cycles_max = cycles;
+		kernel_critical_max.function = kernel_critical_function;
+		kernel_critical_max.line = kernel_critical_line;
+	}
+}
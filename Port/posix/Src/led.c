@@ -0,0 +1,77 @@
+#include <stdint.h>
+#include <stdio.h>
+#include "led.h"
+#include "systick.h"
+
+/* LEDs of the Linux host port.
+ * Every change is written to stderr as a csv line, led,<time_us>,<colour>,<0 or 1>, so traces from several runs
+ * 	can be lined up against each other or plotted like a logic analyzer capture of PD12 to PD15.
+ */
+
+typedef enum {
+	LED_GREEN = 0,
+	LED_ORANGE,
+	LED_RED,
+	LED_BLUE,
+	LED_COUNT
+} led_type;
+
+static const char* const led_names[LED_COUNT] = {
+	"green",
+	"orange",
+	"red",
+	"blue"
+};
+
+static uint8_t led_states[LED_COUNT];
+
+/* Threads run in parallel on the host, the atomic keeps two toggles from reporting the same edge */
+static void led_write(led_type led, uint8_t toggle)
+{
+	uint8_t state;
+
+	if (toggle != 0U) {
+		state = __atomic_xor_fetch(&led_states[led], 1U, __ATOMIC_RELAXED);
+	} else if (__atomic_exchange_n(&led_states[led], 0U, __ATOMIC_RELAXED) != 0U) {
+		state = 0U;
+	} else {
+		return;
+	}
+
+	fprintf(stderr, "led,%llu,%s,%u\n", (unsigned long long)systick_time_us(), led_names[led], (unsigned int)state);
+}
+
+void led_initialize(void)
+{
+	fprintf(stderr, "led,time_us,colour,state\n");
+}
+
+void led_green_toggle(void)
+{
+	led_write(LED_GREEN, 1U);
+}
+
+void led_green_off(void)
+{
+	led_write(LED_GREEN, 0U);
+}
+
+void led_orange_toggle(void)
+{
+	led_write(LED_ORANGE, 1U);
+}
+
+void led_red_toggle(void)
+{
+	led_write(LED_RED, 1U);
+}
+
+void led_blue_off(void)
+{
+	led_write(LED_BLUE, 0U);
+}
+
+void led_blue_toggle(void)
+{
+	led_write(LED_BLUE, 1U);
+}
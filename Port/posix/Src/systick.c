@@ -0,0 +1,147 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "systick.h"
+#include "kernel.h"
+#include "kernel_critical.h"
+#include "kernel_timer.h"
+
+/* Systick of the Linux host port.
+ * Time is CLOCK_MONOTONIC since systick_initialize(), handed out in ticks and in cycles of the board's 16 MHz clock so
+ * 	code that budgets in SYSTICK_CYCLES_PER_TICK works unchanged. Thread timeouts are absolute deadlines on the same
+ * 	clock, so the only periodic work left is the timer wheel, which a tick thread steps above every kernel priority.
+ */
+
+#define NANOSECONDS_PER_TICK	(1000000000U / SYSTICK_TICKS_PER_SECOND)
+
+static void* systick_thread(void* argument);
+static uint64_t systick_nanoseconds(void);
+
+static struct timespec systick_epoch;
+static pthread_t systick_tick_thread;
+
+void systick_initialize(void)
+{
+	pthread_attr_t attributes;
+	struct sched_param parameters;
+
+	clock_gettime(CLOCK_MONOTONIC, &systick_epoch);
+
+	/* Like the Systick interrupt, the tick thread runs above every thread */
+	pthread_attr_init(&attributes);
+	pthread_attr_setinheritsched(&attributes, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attributes, SCHED_FIFO);
+	parameters.sched_priority = sched_get_priority_max(SCHED_FIFO);
+	pthread_attr_setschedparam(&attributes, &parameters);
+	if (pthread_create(&systick_tick_thread, &attributes, &systick_thread, (void*)0U) != 0) {
+		(void)pthread_create(&systick_tick_thread, (const pthread_attr_t*)0U, &systick_thread, (void*)0U);
+	}
+	pthread_attr_destroy(&attributes);
+}
+
+/* Absolute time of the start of tick (current tick + ticks) */
+void kernel_port_tick_deadline(uint32_t ticks, struct timespec* deadline)
+{
+	uint64_t nanoseconds = (systick_tick_count() + ticks) * (uint64_t)NANOSECONDS_PER_TICK;
+
+	nanoseconds += (uint64_t)systick_epoch.tv_nsec;
+	deadline->tv_sec = systick_epoch.tv_sec + (time_t)(nanoseconds / 1000000000U);
+	deadline->tv_nsec = (long)(nanoseconds % 1000000000U);
+}
+
+/* Function to wait at least delay milliseconds. See systick_delay() */
+void systick_delay_ms(uint32_t delay)
+{
+	while (delay > 1000000U) {
+		systick_delay(1000000U * 1000U);
+		delay -= 1000000U;
+	}
+	systick_delay(delay * 1000U);
+}
+
+/* Function to busy wait at least the given number of board clock cycles */
+void systick_delay_cycles(uint32_t cycles)
+{
+	uint64_t deadline = systick_cycle_count() + cycles;
+
+	while (systick_cycle_count() < deadline) {}
+}
+
+/* Function to busy wait at least delay microseconds */
+void systick_delay_us(uint32_t delay)
+{
+	uint64_t deadline = systick_time_us() + delay;
+
+	while (systick_time_us() < deadline) {}
+}
+
+/* Function to wait at least delay microseconds. Sleeping costs no more than a system call on the host, so a thread
+ * 	always sleeps, to the microsecond, and only code outside of the kernel threads spins.
+ */
+void systick_delay(uint32_t delay)
+{
+	struct timespec request;
+
+	if (kernel_tcb_current() == (tcb_type*)0U) {
+		systick_delay_us(delay);
+		return;
+	}
+
+	request.tv_sec = (time_t)(delay / 1000000U);
+	request.tv_nsec = (long)(delay % 1000000U) * 1000L;
+	while (nanosleep(&request, &request) == EINTR) {}
+}
+
+uint64_t systick_tick_count(void)
+{
+	return systick_nanoseconds() / NANOSECONDS_PER_TICK;
+}
+
+uint64_t systick_cycle_count(void)
+{
+	return (systick_nanoseconds() * SYSTICK_CYCLES_PER_US) / 1000U;
+}
+
+uint64_t systick_time_us(void)
+{
+	return systick_nanoseconds() / 1000U;
+}
+
+static uint64_t systick_nanoseconds(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t)(now.tv_sec - systick_epoch.tv_sec) * 1000000000U)
+		+ (uint64_t)(now.tv_nsec - systick_epoch.tv_nsec);
+}
+
+/* Steps the timer wheel once per tick, inside the critical section like the Systick Handler runs with every thread
+ * 	held off. A late wake up catches up tick by tick so no timer is skipped.
+ */
+static void* systick_thread(void* argument)
+{
+	uint32_t primask;
+	uint64_t tick = 0U;
+
+	(void)argument;
+
+	while (1) {
+		struct timespec deadline;
+
+		kernel_port_tick_deadline(1U, &deadline);
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, (struct timespec*)0U) == EINTR) {}
+
+		primask = kernel_critical_enter();
+		while (tick < systick_tick_count()) {
+			tick++;
+			kernel_timer_tick();
+		}
+		kernel_critical_exit(primask);
+	}
+
+	return (void*)0U;
+}
@@ -0,0 +1,445 @@
+#include <stdint.h>
+#include "stm32f407xx.h"
+#include "kernel.h"
+#include "kernel_critical.h"
+#include "kernel_notify.h"
+#include "active_object.h"
+
+#define LOG2(x) (32U - __builtin_clz(x))
+#define AO_TRIGGER(state, signal) ((state)(me, &ao_reserved_events[(signal)]))
+
+#if (AO_MAX_ACTIVE < 1) || (AO_MAX_ACTIVE > 32)
+#error "AO_MAX_ACTIVE must be 1 to 32, every AO is one bit of a 32 bit mask"
+#endif
+
+/* Fixed block event pool. Free blocks are chained through their first word. */
+typedef struct {
+	void* free_list;
+	uint16_t block_size;
+	uint16_t free_count;
+} ao_pool_type;
+
+static void ao_dispatcher(void);
+static void ao_event_gc(const ao_event_type* e);
+static ao_state_handler ao_hsm_super(ao_type* me, ao_state_handler state);
+static void ao_hsm_enter(ao_type* me, ao_state_handler from, ao_state_handler target);
+static void ao_hsm_drill(ao_type* me, ao_state_handler state);
+static void ao_hsm_init(ao_type* me, ao_state_handler initial);
+static void ao_hsm_dispatch(ao_type* me, const ao_event_type* e);
+
+static const ao_event_type ao_reserved_events[] = {
+	{ AO_SIGNAL_EMPTY, 0U, 0U },
+	{ AO_SIGNAL_ENTRY, 0U, 0U },
+	{ AO_SIGNAL_EXIT, 0U, 0U },
+	{ AO_SIGNAL_INIT, 0U, 0U }
+};
+
+static ao_type* ao_registry[AO_MAX_ACTIVE + 1];	/* AOs indexed by priority, slot 0 unused */
+static volatile uint32_t ao_ready_mask;			/* bit (priority - 1) is set while that AO has queued events */
+static uint32_t ao_subscribers[AO_MAX_SIGNALS];	/* per signal mask of subscribed AO priorities */
+static ao_pool_type ao_pools[AO_MAX_POOLS];
+static uint8_t ao_pool_count;
+static tcb_type* ao_dispatcher_tcb;
+
+ao_state_result ao_state_top(ao_type* me, const ao_event_type* e)
+{
+	(void)me;
+	(void)e;
+	return AO_RET_IGNORED;
+}
+
+/* Function to start the thread that runs every AO. Its thread priority is the priority all AOs run at
+ * 	relative to the other threads in the system.
+ */
+void ao_framework_start(tcb_type* dispatcher, uint8_t priority, void* stack_array, uint32_t stack_size)
+{
+	ao_dispatcher_tcb = dispatcher;
+
+	kernel_tcb_start(
+		dispatcher,
+		priority,
+		&ao_dispatcher,
+		stack_array,
+		stack_size);
+}
+
+/* Function to start an AO. The initial transition, including every entry action on the way to the initial leaf
+ * 	state, runs right away in the context of the caller.
+ * The priority indexes the registry and the ready and subscriber masks, so one outside 1 to AO_MAX_ACTIVE or one
+ * 	already taken is refused before anything is touched.
+ */
+kernel_status_type ao_start(
+	ao_type* me,
+	uint8_t priority,
+	ao_state_handler initial,
+	const ao_event_type** queue_storage,
+	uint8_t queue_length)
+{
+	if ((priority == 0U) || (priority > AO_MAX_ACTIVE) || (ao_registry[priority] != (ao_type*)0U)) {
+		return KERNEL_INVALID;
+	}
+
+	me->queue = queue_storage;
+	me->queue_length = queue_length;
+	me->queue_head = 0U;
+	me->queue_tail = 0U;
+	me->queue_count = 0U;
+	me->priority = priority;
+	ao_registry[priority] = me;
+
+	ao_hsm_init(me, initial);
+
+	return KERNEL_OK;
+}
+
+/* Function to add a pool of fixed size event blocks.
+ * Pools must be added smallest block size first, ao_event_new() takes the first pool whose blocks are big enough.
+ */
+void ao_pool_initialize(void* storage, uint32_t storage_size, uint16_t block_size)
+{
+	ao_pool_type* pool;
+	uint8_t* block = (uint8_t*)storage;
+	uint32_t i;
+
+	if (ao_pool_count >= AO_MAX_POOLS) {
+		return;
+	}
+	pool = &ao_pools[ao_pool_count];
+
+	/* Round the block size up so every block can hold the free list link and stays word aligned */
+	if (block_size < sizeof(void*)) {
+		block_size = sizeof(void*);
+	}
+	block_size = (uint16_t)((block_size + 3U) & ~3U);
+
+	pool->block_size = block_size;
+	pool->free_count = (uint16_t)(storage_size / block_size);
+	pool->free_list = (void*)0U;
+
+	/* Chain the blocks back to front so the first block ends up at the head of the free list */
+	for (i = pool->free_count; i > 0U; i--) {
+		void** link = (void**)&block[(i - 1U) * block_size];
+		*link = pool->free_list;
+		pool->free_list = link;
+	}
+
+	ao_pool_count++;
+}
+
+/* Function to allocate a dynamic event, safe to call from an ISR.
+ * size is the size of the whole event struct, including any parameters after the ao_event_type header.
+ * Returns NULL if no pool has a free block that big.
+ */
+ao_event_type* ao_event_new(uint16_t size, uint16_t signal)
+{
+	uint32_t primask;
+	ao_event_type* e = (ao_event_type*)0U;
+	uint8_t i;
+
+	for (i = 0U; i < ao_pool_count; i++) {
+		if (ao_pools[i].block_size >= size) {
+			break;
+		}
+	}
+	if (i == ao_pool_count) {
+		return e;
+	}
+
+	primask = kernel_critical_enter();
+	if (ao_pools[i].free_list != (void*)0U) {
+		e = (ao_event_type*)ao_pools[i].free_list;
+		ao_pools[i].free_list = *(void**)ao_pools[i].free_list;
+		ao_pools[i].free_count--;
+	}
+	kernel_critical_exit(primask);
+
+	if (e != (ao_event_type*)0U) {
+		e->signal = signal;
+		e->pool_id = (uint8_t)(i + 1U);
+		e->ref_count = 0U;
+	}
+
+	return e;
+}
+
+/* Function to post an event to an AO's queue, safe to call from an ISR.
+ * Returns 1 if the event was queued and 0 if the queue was full. A dynamic event that nobody else holds a reference
+ * 	to is recycled when the post fails, so it can't leak.
+ */
+uint32_t ao_post(ao_type* me, const ao_event_type* e)
+{
+	uint32_t primask;
+	uint32_t posted = 0U;
+	uint32_t wake = 0U;
+
+	primask = kernel_critical_enter();
+
+	if (me->queue_count < me->queue_length) {
+		if (e->pool_id != 0U) {
+			((ao_event_type*)e)->ref_count++;
+		}
+
+		me->queue[me->queue_head] = e;
+		me->queue_head++;
+		if (me->queue_head == me->queue_length) {
+			me->queue_head = 0U;
+		}
+		me->queue_count++;
+
+		/* The dispatcher only sleeps once the ready mask is empty, so only the first post needs to wake it up */
+		wake = (ao_ready_mask == 0U);
+		ao_ready_mask |= (1U << (me->priority - 1U));
+		posted = 1U;
+	}
+
+	kernel_critical_exit(primask);
+
+	if (wake != 0U) {
+		kernel_notify(ao_dispatcher_tcb, 0U, KERNEL_NOTIFY_INCREMENT);
+	}
+	if ((posted == 0U) && (e->pool_id != 0U) && (e->ref_count == 0U)) {
+		((ao_event_type*)e)->ref_count = 1U;
+		ao_event_gc(e);
+	}
+
+	return posted;
+}
+
+void ao_subscribe(ao_type* me, uint16_t signal)
+{
+	uint32_t primask;
+
+	if (signal < AO_MAX_SIGNALS) {
+		primask = kernel_critical_enter();
+		ao_subscribers[signal] |= (1U << (me->priority - 1U));
+		kernel_critical_exit(primask);
+	}
+}
+
+void ao_unsubscribe(ao_type* me, uint16_t signal)
+{
+	uint32_t primask;
+
+	if (signal < AO_MAX_SIGNALS) {
+		primask = kernel_critical_enter();
+		ao_subscribers[signal] &= ~(1U << (me->priority - 1U));
+		kernel_critical_exit(primask);
+	}
+}
+
+/* Function to post an event to every AO subscribed to its signal, highest priority first.
+ * The publisher holds its own reference for the whole multicast, so the first subscriber can't finish with a
+ * 	dynamic event and recycle it before the rest have it queued.
+ */
+void ao_publish(const ao_event_type* e)
+{
+	uint32_t primask;
+	uint32_t mask = 0U;
+
+	if (e->pool_id != 0U) {
+		primask = kernel_critical_enter();
+		((ao_event_type*)e)->ref_count++;
+		kernel_critical_exit(primask);
+	}
+
+	if (e->signal < AO_MAX_SIGNALS) {
+		mask = ao_subscribers[e->signal];
+	}
+
+	while (mask != 0U) {
+		uint32_t priority = LOG2(mask);
+
+		(void)ao_post(ao_registry[priority], e);
+		mask &= ~(1U << (priority - 1U));
+	}
+
+	ao_event_gc(e);
+}
+
+/* Dispatcher thread body.
+ * Picks the highest priority AO with a queued event, takes one event and runs it to completion. An AO is never
+ * 	preempted by another AO, so state machines need no locking among themselves.
+ */
+static void ao_dispatcher(void)
+{
+	uint32_t primask;
+
+	while (1) {
+		uint32_t mask;
+		ao_type* ao;
+		const ao_event_type* e;
+
+		primask = kernel_critical_enter();
+		mask = ao_ready_mask;
+		kernel_critical_exit(primask);
+
+		if (mask == 0U) {
+			(void)kernel_notify_wait(0xFFFFFFFFU, (uint32_t*)0U, KERNEL_WAIT_FOREVER);
+			continue;
+		}
+
+		ao = ao_registry[LOG2(mask)];
+
+		primask = kernel_critical_enter();
+		e = ao->queue[ao->queue_tail];
+		ao->queue_tail++;
+		if (ao->queue_tail == ao->queue_length) {
+			ao->queue_tail = 0U;
+		}
+		ao->queue_count--;
+		if (ao->queue_count == 0U) {
+			ao_ready_mask &= ~(1U << (ao->priority - 1U));
+		}
+		kernel_critical_exit(primask);
+
+		ao_hsm_dispatch(ao, e);
+		ao_event_gc(e);
+	}
+}
+
+/* Drop one reference to an event and give it back to its pool once nobody holds it anymore */
+static void ao_event_gc(const ao_event_type* e)
+{
+	uint32_t primask;
+	ao_event_type* event = (ao_event_type*)e;
+	ao_pool_type* pool;
+
+	if (event->pool_id == 0U) {
+		return;
+	}
+
+	primask = kernel_critical_enter();
+	if (event->ref_count > 1U) {
+		event->ref_count--;
+	} else {
+		pool = &ao_pools[event->pool_id - 1U];
+		*(void**)event = pool->free_list;
+		pool->free_list = event;
+		pool->free_count++;
+	}
+	kernel_critical_exit(primask);
+}
+
+/* Every state handler answers the empty signal with AO_SUPER(parent), that's how the processor finds the hierarchy.
+ * The top state has no parent.
+ */
+static ao_state_handler ao_hsm_super(ao_type* me, ao_state_handler state)
+{
+	if (state == &ao_state_top) {
+		return (ao_state_handler)0U;
+	}
+
+	(void)AO_TRIGGER(state, AO_SIGNAL_EMPTY);
+	return me->temp;
+}
+
+/* Run the entry actions from just below "from" down to target, outermost first. "from" must be an ancestor of target. */
+static void ao_hsm_enter(ao_type* me, ao_state_handler from, ao_state_handler target)
+{
+	ao_state_handler path[AO_HSM_MAX_DEPTH];
+	ao_state_handler state;
+	uint32_t depth = 0U;
+
+	for (state = target; (state != from) && (state != (ao_state_handler)0U) && (depth < AO_HSM_MAX_DEPTH);
+		state = ao_hsm_super(me, state)) {
+		path[depth++] = state;
+	}
+
+	while (depth > 0U) {
+		(void)AO_TRIGGER(path[--depth], AO_SIGNAL_ENTRY);
+	}
+}
+
+/* Follow the initial transitions from state down to the leaf state and make that leaf the current state */
+static void ao_hsm_drill(ao_type* me, ao_state_handler state)
+{
+	while (AO_TRIGGER(state, AO_SIGNAL_INIT) == AO_RET_TRAN) {
+		ao_state_handler target = me->temp;
+
+		ao_hsm_enter(me, state, target);
+		state = target;
+	}
+
+	me->state = state;
+}
+
+/* The initial pseudo state handler just returns AO_TRAN() to the first real state */
+static void ao_hsm_init(ao_type* me, ao_state_handler initial)
+{
+	ao_state_handler target;
+
+	me->state = &ao_state_top;
+	(void)initial(me, &ao_reserved_events[AO_SIGNAL_EMPTY]);
+	target = me->temp;
+
+	ao_hsm_enter(me, &ao_state_top, target);
+	ao_hsm_drill(me, target);
+}
+
+/* Dispatch one event to the state machine.
+ * The event is offered to the current leaf state first and bubbles up through the super states until one of them
+ * 	handles it or the top state ignores it. If the handling state takes a transition:
+ * 1) Exit every state from the current leaf up to the handling state.
+ * 2) Keep exiting up from the handling state until reaching a strict ancestor of the target, the least common ancestor.
+ * 	A self transition, or a transition to an ancestor, therefore exits and re-enters the target like UML says.
+ * 3) Enter every state from below the least common ancestor down to the target.
+ * 4) Follow the target's initial transitions down to the new leaf.
+ * The target of a transition can never be the top state.
+ */
+static void ao_hsm_dispatch(ao_type* me, const ao_event_type* e)
+{
+	ao_state_handler path[AO_HSM_MAX_DEPTH];
+	ao_state_handler source = me->state;
+	ao_state_handler handler = source;
+	ao_state_handler target;
+	ao_state_handler state;
+	ao_state_result result;
+	uint32_t depth = 0U;
+	uint32_t k;
+
+	do {
+		result = handler(me, e);
+		if (result == AO_RET_SUPER) {
+			handler = me->temp;
+		}
+	} while (result == AO_RET_SUPER);
+
+	if (result != AO_RET_TRAN) {
+		return;
+	}
+	target = me->temp;
+
+	/* 1) */
+	for (state = source; state != handler; state = ao_hsm_super(me, state)) {
+		(void)AO_TRIGGER(state, AO_SIGNAL_EXIT);
+	}
+
+	/* path[0] is the target and path[depth - 1] is the top state */
+	for (state = target; (state != (ao_state_handler)0U) && (depth < AO_HSM_MAX_DEPTH); state = ao_hsm_super(me, state)) {
+		path[depth++] = state;
+	}
+
+	/* 2) Only path[1] and above count as ancestors of the target */
+	state = handler;
+	while (1) {
+		for (k = 1U; k < depth; k++) {
+			if (path[k] == state) {
+				break;
+			}
+		}
+		if ((k < depth) || (state == (ao_state_handler)0U)) {
+			break;
+		}
+
+		(void)AO_TRIGGER(state, AO_SIGNAL_EXIT);
+		state = ao_hsm_super(me, state);
+	}
+
+	/* 3) */
+	while (k > 0U) {
+		(void)AO_TRIGGER(path[--k], AO_SIGNAL_ENTRY);
+	}
+
+	/* 4) */
+	ao_hsm_drill(me, target);
+}
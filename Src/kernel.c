@@ -1,21 +1,40 @@
 #include <stdint.h>
 #include "stm32f407xx.h"
 #include "kernel.h"
+#include "kernel_critical.h"
+#include "kernel_bitmap.h"
 #include "led.h"
-
-#define LOG2(x) (32U - __builtin_clz(x))
+#if KERNEL_TRACE
+#include "systick.h"
+#endif
+#if KERNEL_BUDGET
+#include "kernel_budget.h"
+#endif
 
 static void kernel_on_idle(void);
+static void kernel_tcb_ready_insert(tcb_type* tcb);
+static void kernel_tcb_ready_remove(tcb_type* tcb);
+static void kernel_tcb_delayed_insert(tcb_type* tcb);
+static void kernel_tcb_delayed_remove(tcb_type* tcb);
+static void kernel_tcb_wait_remove(tcb_type* tcb);
+#if KERNEL_BUDGET
+static void kernel_tcb_budget_end(tcb_type* tcb);
+#endif
 
 /* These pointers will be used inside ISRs so make sure they're volatile */
 static tcb_type* volatile current_thread;
 static tcb_type* volatile next_thread;
 
-static tcb_type* kernel_tcbs[32 + 1];	/* array that holds all the thread pointers */
+static tcb_type* kernel_tcbs[KERNEL_PRIORITY_MAX + 1];	/* array that holds the head of the ready list for every priority */
 static uint8_t kernel_tcbs_count;		/* int value that keeps count of total threads started */
 static uint8_t kernel_tcbs_index;		/* index value to be used for round robin scheduling */
-static uint32_t kernel_tcbs_ready_mask;		/* 32 bit mask to keep track of all thread's and whether they are ready */
-static uint32_t kernel_tcbs_delayed_mask;	/* 32 bit mask to keep rack of all delayed threads with priority scheduler implementation */
+static kernel_bitmap_type kernel_tcbs_ready_mask;	/* two level bitmap to keep track of which priorities have at least one ready thread */
+static tcb_type* kernel_tcbs_delayed;		/* list of all blocked threads waiting for their timeout */
+
+#if KERNEL_TRACE
+volatile uint32_t kernel_trace_pendsv_set;	/* timestamp of the last context switch a scheduler pended */
+static uint8_t kernel_trace_use_systick;	/* the DWT cycle counter doesn't count, like under QEMU */
+#endif
 
 
 uint32_t idlethread_stack[40];
@@ -33,6 +52,29 @@ void kernel_initialize(void)
 	NVIC_SetPriority(SysTick_IRQn, 0U);
 	NVIC_SetPriority(PendSV_IRQn, 0xFFU);
 
+#if KERNEL_CRITICAL_TRACE
+	/* Critical sections are timed with the DWT cycle counter, which only counts once trace is enabled */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+#if KERNEL_TRACE
+	{
+		uint32_t start;
+
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+		/* Emulators often leave the DWT cycle counter at 0, fall back to the Systick based clock when it stands still */
+		start = DWT->CYCCNT;
+		__NOP();
+		__NOP();
+		__NOP();
+		__NOP();
+		kernel_trace_use_systick = (DWT->CYCCNT == start);
+	}
+#endif
+
 	kernel_tcb_start(
 			&idlethread,
 			0U,
@@ -45,22 +87,26 @@ void kernel_initialize(void)
  * Set the priorities for the interrupts so PendSV does NOT preempt Systick.
  * PendSV should only context switch by tail-chaining and once other interrupts have already been serviced.
  * Start the scheduler to initiate the running state of one thread, without having to wait for the Systick to trigger it first.
+ * The first PendSV returns in to that thread on the PSP, which also sets CONTROL.SPSEL, so from then on threads run on
+ * 	their own stacks and only handlers use the MSP. The frames of main() stay at the top of the MSP, never returned to.
  */
 void kernel_run(void)
 {
-	__disable_irq();
+	uint32_t primask;
+
+	primask = kernel_critical_enter();
 	kernel_scheduler_priority_based();
-	__enable_irq();
+	kernel_critical_exit(primask);
 }
 
 void kernel_scheduler_priority_based(void)
 {
 	/* If no threads are ready to run, run the idle thread by setting the next thread manually to idle thread.
-	 * Else, calculate the priority by finding the leading zeroes and then subtracting from 32 by using LOG2(x) define */
-	if (kernel_tcbs_ready_mask == 0U) {
+	 * Else, find the highest ready priority with one clz on the group mask and one on the word it points to */
+	if (kernel_bitmap_empty(&kernel_tcbs_ready_mask)) {
 		next_thread = kernel_tcbs[0];
 	} else {
-		next_thread = kernel_tcbs[LOG2(kernel_tcbs_ready_mask)];
+		next_thread = kernel_tcbs[kernel_bitmap_highest(&kernel_tcbs_ready_mask)];
 	}
 
 	if (next_thread != current_thread) {
@@ -73,26 +119,26 @@ void kernel_scheduler_priority_based(void)
 		led_green_off();
 		led_blue_off();
 		SCB->ICSR |= SCB_ICSR_PENDSVSET_Msk;
+#if KERNEL_TRACE
+		kernel_trace_pendsv_set = kernel_trace_timestamp();
+#endif
 	}
 }
 
 void kernel_scheduler_round_robin(void)
 {
 	/* If no threads are ready to run, run the idle thread by setting the index to 0 */
-	if (kernel_tcbs_ready_mask == 0U) {
+	if (kernel_bitmap_empty(&kernel_tcbs_ready_mask)) {
 		kernel_tcbs_index = 0U;
 	} else {
-		/* We need to check which thread(s) is ready to run. This means iterating through the array of all tcbs.
-		 * At each iteration, we check the corresponding ready_mask bit for that thread_index and run it if its ready.
-		 * The loop should continue to run as long as the thread bit it's checking is 0, UNTIL it reaches a ready thread. */
-		do {
-			++kernel_tcbs_index;
-			/* Wrap around to the beginning of the tcbs array once you get to the end.
-			 * Skipping the idle thread. */
-			if (kernel_tcbs_index == kernel_tcbs_count) {
-				kernel_tcbs_index = 1U;
-			}
-		} while ((kernel_tcbs_ready_mask & (1U << (kernel_tcbs_index - 1U))) == 0U);
+		/* Thread kernel_tcbs[i] owns bit (i - 1) of the ready bitmap, so every bit from position kernel_tcbs_index upwards
+		 * belongs to a thread that comes after the last run thread in the rotation.
+		 * Masking off the lower bits rotates the ready bitmap around the last run index, and the lowest remaining set bit
+		 * is the next thread to run. If nothing is ready above the last run thread, wrap around to the lowest ready bit.
+		 * This replaces walking the index forward one slot at a time, so the cost no longer depends on how many threads
+		 * are blocked in between.
+		 */
+		kernel_tcbs_index = kernel_bitmap_next(&kernel_tcbs_ready_mask, kernel_tcbs_index);
 	}
 	/* Once it's found a ready thread, schedule it to run as the next thread */
 	next_thread = kernel_tcbs[kernel_tcbs_index];
@@ -105,6 +151,9 @@ void kernel_scheduler_round_robin(void)
 		 * 	This means you have to use the SCB_ICSR register to set the pending bit.
 		 */
 		SCB->ICSR |= SCB_ICSR_PENDSVSET_Msk;
+#if KERNEL_TRACE
+		kernel_trace_pendsv_set = kernel_trace_timestamp();
+#endif
 	}
 }
 
@@ -116,6 +165,24 @@ void kernel_tcb_start(
 	void* stack_array,
 	uint32_t stack_size)
 {
+	/* Threads without an argument keep the recognizable R0 fill pattern for debugging */
+	kernel_tcb_start_argument(me, priority, tcb_handler, (void*)0xAAAAAAA0U, stack_array, stack_size);
+}
+
+/* Function to initialize threads that take an argument.
+ * The argument is placed in the stacked R0, so by the AAPCS it arrives as the first parameter of tcb_handler
+ * 	once the exception return from PendSV unstacks the frame.
+ */
+void kernel_tcb_start_argument(
+	tcb_type* me,
+	uint8_t priority,
+	tcb_type_handler tcb_handler,
+	void* argument,
+	void* stack_array,
+	uint32_t stack_size)
+{
+	uint32_t primask;
+
 	/* In ARM Cortex M, the stack grows from high to low memory so we need to start from the END of the stack, hence we add stack_size.
 	 * The stack also needs to be aligned at the 8 byte boundary, so we integer divide by 8 then * by 8 to guarantee this.
 	 * For example, 52 is 4 bytes aligned, but not 8 bytes aligned. Integer division by 8 then * 8 results in 48, which is 8 bytes aligned.
@@ -149,7 +216,7 @@ void kernel_tcb_start(
 	*(--sp) = 0xAAAAAAA3U;				/* R3  */
 	*(--sp) = 0xAAAAAAA2U;				/* R2  */
 	*(--sp) = 0xAAAAAAA1U;				/* R1  */
-	*(--sp) = 0xAAAAAAA0U;				/* R0  */
+	*(--sp) = (uint32_t)argument;		/* R0  */
 
 	*(--sp) = 0xAAAAAAABU;				/* R11 */
 	*(--sp) = 0xAAAAAAAAU;				/* R10 */
@@ -171,21 +238,52 @@ void kernel_tcb_start(
 	}
 
 	me->priority = priority;
+	me->base_priority = priority;
+	me->locks = 0U;
+	me->quantum = KERNEL_TIME_SLICE_TICKS;
+	me->wait_list = (tcb_type**)0U;
+	me->notify_value = 0U;
+	me->notify_waiter = (tcb_type*)0U;
+	me->notify_pending = 0U;
+#if KERNEL_BUDGET
+	me->budget = 0U;
+	me->budget_used = 0U;
+	me->budget_start = 0U;
+	me->budget_max = 0U;
+	me->budget_overruns = 0U;
+	me->budget_policy = 0U;
+	me->budget_state = 0U;
+#endif
 	kernel_tcbs_count++;
 
-	/* Check to make sure we don't go over the thread limit */
-	if (kernel_tcbs_count < (sizeof(kernel_tcbs) / sizeof(kernel_tcbs[0]))) {
-		kernel_tcbs[priority] = me;
+	/* The idle thread gets the reserved slot 0 and is never part of the ready mask.
+	 * Linking it to itself makes it look like a thread that is alone at its priority, so it is never time sliced.
+	 * For all non-idle threads, make sure to add them to the ready list of their priority.
+	 * Check to make sure the priority fits in the tcbs array.
+	 * Threads can be started while Systick is already walking the lists, so link the thread in a critical section.
+	 */
+	primask = kernel_critical_enter();
+	if (priority == 0U) {
+		me->next = me;
+		me->prev = me;
+		me->state = KERNEL_TCB_READY;
+		kernel_tcbs[0] = me;
+	} else if ((uint32_t)priority <= KERNEL_PRIORITY_MAX) {
+		kernel_tcb_ready_insert(me);
 	}
+	kernel_critical_exit(primask);
+}
 
-	/* For all non-idle threads, make sure to set them ready to run.
-	 * We skip the idle thread by checking > 1 */
-	if (priority > 0) {
-		kernel_tcbs_ready_mask |= (1U << (priority - 1));
-	}
+/* Function to change the time slice of a thread.
+ * The new quantum takes effect the next time the thread is added to its ready list.
+ */
+void kernel_tcb_set_quantum(tcb_type* me, uint32_t quantum)
+{
+	uint32_t primask;
 
-/*	 Increment the count at the end, otherwise the tcbs_ready_mask won't be set properly and the bit alignment will be off
-	kernel_tcbs_count++;*/
+	primask = kernel_critical_enter();
+	me->quantum = quantum;
+	kernel_critical_exit(primask);
 }
 
 /* Function to block current thread for a specified amount of time.
@@ -193,63 +291,394 @@ void kernel_tcb_start(
  */
 void kernel_tcb_block(uint32_t blocking_timeout)
 {
+	uint32_t primask;
+
 	/* The thread blocking must happen inside of a critical section */
-	__disable_irq();
+	primask = kernel_critical_enter();
+	(void)kernel_tcb_wait((tcb_type**)0U, blocking_timeout);
+	kernel_critical_exit(primask);
+}
+
+/* Function to block the current thread on a kernel object's wait list until it is woken up with kernel_tcb_wake()
+ * 	or the timeout runs out. Passing a NULL wait list simply delays the thread.
+ * Kernel objects fill in the wait_mask, wait_value and wait_options of the current thread before calling this.
+ *
+ * Must be called with interrupts disabled, so the caller can check its condition and block atomically.
+ * The context switch happens as soon as interrupts are enabled in here, and the thread continues from that point once
+ * 	it runs again. Interrupts are disabled again before returning so the caller can read its results safely.
+ */
+kernel_status_type kernel_tcb_wait(tcb_type** wait_list, uint32_t timeout)
+{
+	tcb_type* tcb = current_thread;
 
 	/* The blocking function should NEVER be called on the idle thread */
-	if (current_thread != kernel_tcbs[0]) {
+	if (tcb == kernel_tcbs[0]) {
+		return KERNEL_TIMEOUT;
+	}
+
+	/* First load the desired blocking timeout to the thread attribute.
+	 * The status stays at timeout unless a kernel object wakes the thread up first.
+	 */
+	tcb->timeout = timeout;
+	tcb->wait_status = KERNEL_TIMEOUT;
+
+	/* Push the thread on to the front of the object's wait list */
+	tcb->wait_list = wait_list;
+	if (wait_list != (tcb_type**)0U) {
+		tcb->wait_prev = (tcb_type*)0U;
+		tcb->wait_next = *wait_list;
+		if (*wait_list != (tcb_type*)0U) {
+			(*wait_list)->wait_prev = tcb;
+		}
+		*wait_list = tcb;
+	}
 
-		/* First load the desired blocking timeout to the thread attribute */
-		current_thread->timeout = blocking_timeout;
+#if KERNEL_BUDGET
+	kernel_tcb_budget_end(tcb);
+#endif
 
-		/* Then block the thread by clearing the appropriate bit in the tcb ready mask.
-		 * And setting the appropriate bit in the tcb delayed mask.
-		 */
-		kernel_tcbs_ready_mask &= ~(1U << (current_thread->priority - 1U));
-		kernel_tcbs_delayed_mask |= (1U << (current_thread->priority - 1U));
+	/* Then block the thread by taking it out of the ready list of its priority.
+	 * And adding it to the delayed list.
+	 */
+	kernel_tcb_ready_remove(tcb);
+	kernel_tcb_delayed_insert(tcb);
+	tcb->state = KERNEL_TCB_BLOCKED;
+
+	/* Immediately call the scheduler to context switch away from the blocked thread */
+	kernel_scheduler_priority_based();
+
+	/* Blocking only ever happens from a thread, so interrupts were unmasked before the caller's section and are fully
+	 * 	unmasked here. The ISB makes sure the pending PendSV is taken right here before interrupts are disabled again.
+	 */
+	kernel_critical_exit(0U);
+	__ISB();
+	(void)kernel_critical_enter();
+
+	return (kernel_status_type)tcb->wait_status;
+}
 
-		/* Immediately call the scheduler to context switch away from the blocked thread */
-		kernel_scheduler_priority_based();
+/* Function for kernel objects to make a waiting thread ready again.
+ * It doesn't call the scheduler, so an object can wake every thread it needs to and then reschedule once.
+ * Must be called inside of a critical section or from an ISR.
+ */
+void kernel_tcb_wake(tcb_type* tcb, kernel_status_type status)
+{
+	tcb->wait_status = (uint8_t)status;
+
+	kernel_tcb_wait_remove(tcb);
+	kernel_tcb_delayed_remove(tcb);
+	kernel_tcb_ready_insert(tcb);
+}
+
+#if KERNEL_BUDGET
+/* Function to take a ready thread off the CPU until kernel_tcb_wake() makes it ready again, for example to stop a
+ * 	runaway thread from the Systick Handler. It waits on nothing and never times out.
+ * Must be called inside of a critical section or from an ISR. It doesn't call the scheduler.
+ */
+void kernel_tcb_suspend(tcb_type* tcb)
+{
+	if ((tcb->state != KERNEL_TCB_READY) || (tcb == kernel_tcbs[0])) {
+		return;
 	}
 
-	__enable_irq();
+	tcb->timeout = KERNEL_WAIT_FOREVER;
+	tcb->wait_status = KERNEL_TIMEOUT;
+	kernel_tcb_ready_remove(tcb);
+	kernel_tcb_delayed_insert(tcb);
+	tcb->state = KERNEL_TCB_BLOCKED;
+}
+#endif
+
+#if KERNEL_TRACE
+/* Cycle resolution timestamp for latency tracing that works on the board and under QEMU alike.
+ * The Systick fallback is slower to read and needs systick_initialize() to have run.
+ */
+uint32_t kernel_trace_timestamp(void)
+{
+	if (kernel_trace_use_systick != 0U) {
+		return (uint32_t)systick_cycle_count();
+	}
+
+	return DWT->CYCCNT;
+}
+#endif
+
+tcb_type* kernel_tcb_current(void)
+{
+	return current_thread;
+}
+
+/* Function to move a thread to a different priority.
+ * A ready thread is moved to the HEAD of its new priority's ready list, so the running thread keeps running when it is
+ * 	moved to a level that already has ready threads. A blocked thread just takes the new priority once it is made ready.
+ * Must be called inside of a critical section. It doesn't call the scheduler, the caller decides when to reschedule.
+ */
+void kernel_tcb_set_priority(tcb_type* tcb, uint8_t priority)
+{
+	if ((priority == 0U) || ((uint32_t)priority > KERNEL_PRIORITY_MAX) || (tcb == kernel_tcbs[0])) {
+		return;
+	}
+
+	if (tcb->state == KERNEL_TCB_READY) {
+		kernel_tcb_ready_remove(tcb);
+		tcb->priority = priority;
+		kernel_tcb_ready_insert(tcb);
+
+		/* Inserting puts the thread at the tail, the node right before the head, so stepping the head back makes it the head */
+		kernel_tcbs[priority] = tcb;
+	} else {
+		tcb->priority = priority;
+	}
+}
+
+/* Function to change the priority a thread was given, for example when admission control re-ranks it.
+ * A thread that holds a kernel_resource or whose job is demoted stays where it is, the new base priority takes effect
+ * 	once it releases its last resource or its job ends, which is where it would have gone back to the old one.
+ * Must be called inside of a critical section. It doesn't call the scheduler.
+ */
+void kernel_tcb_set_base_priority(tcb_type* tcb, uint8_t priority)
+{
+	if ((priority == 0U) || ((uint32_t)priority > KERNEL_PRIORITY_MAX) || (tcb == kernel_tcbs[0])) {
+		return;
+	}
+
+	tcb->base_priority = priority;
+	if (tcb->locks == 0U) {
+		kernel_tcb_restore_priority(tcb);
+	}
+}
+
+/* Function to move a thread that holds no resource back to where it belongs: its base priority, or the background
+ * 	priority while its job is demoted.
+ * Must be called inside of a critical section. It doesn't call the scheduler.
+ */
+void kernel_tcb_restore_priority(tcb_type* tcb)
+{
+	uint8_t priority = tcb->base_priority;
+
+#if KERNEL_BUDGET
+	if (tcb->budget_state == KERNEL_BUDGET_STATE_DEMOTED) {
+		priority = KERNEL_BUDGET_BACKGROUND_PRIORITY;
+	}
+#endif
+
+	if (tcb->priority != priority) {
+		kernel_tcb_set_priority(tcb, priority);
+	}
 }
 
 /* This function works in tandem with the kernel_tcb_block().
- * At every iteration of the Systick Handler, this function is called to go through each timeout value
- * 	for every thread in kernel_tcbs[] and decrement all non-0 timeout values by 1. If the timeout value
- * 	reaches 0, then unblock the thread.
+ * At every iteration of the Systick Handler, this function is called to go through each thread in the delayed list
+ * 	and decrement all non-0 timeout values by 1. If the timeout value reaches 0, then unblock the thread.
  */
 void kernel_tcb_permit(void)
 {
-	uint32_t kernel_tcbs_working_mask = kernel_tcbs_delayed_mask;
+	tcb_type* tcb = kernel_tcbs_delayed;
 
-	/* the idea is to only iterate over the 1 bits, instead of all the bits since there could be big gaps between priorities.
-	 * As long as a bit is set in the working_mask, this means some threads are still blocked and need to be processed for their
-	 * timeouts.
+	/* Only the blocked threads are on the delayed list, so there is no need to look at every thread.
+	 * The next pointer has to be saved first because unblocking a thread moves it on to its ready list.
 	 */
-	while (kernel_tcbs_working_mask != 0U) {
-		tcb_type* tcb = kernel_tcbs[LOG2(kernel_tcbs_working_mask)];
+	while (tcb != (tcb_type*)0U) {
+		tcb_type* tcb_next = tcb->next;
 
 		/* Conditional sanity check for the thread tcb.
-		 * Make sure the thread is in use and the timeout isn't 0 yet because it must be a delayed thread */
-		if ((tcb != (tcb_type*)0U) && (tcb->timeout != 0)) {
+		 * Make sure the timeout isn't 0 yet because it must be a delayed thread */
+		if (tcb->timeout != 0U) {
 			tcb->timeout--;
 
 			/* If the timeout reaches 0, then we need to make the thread ready to run.
-			 * Also clear the bit in the delayed mask since it's no longer delayed
+			 * Also remove it from the delayed list since it's no longer delayed, and from the wait list of the
+			 * kernel object it was waiting on. Its wait status is left at timeout.
 			 */
-			if (tcb->timeout == 0) {
-				kernel_tcbs_ready_mask |= (1U << (tcb->priority - 1));
-				kernel_tcbs_delayed_mask &= ~(1U << (tcb->priority - 1));
+			if (tcb->timeout == 0U) {
+				kernel_tcb_wait_remove(tcb);
+				kernel_tcb_delayed_remove(tcb);
+				kernel_tcb_ready_insert(tcb);
 			}
+		}
 
-			/* The thread should always be removed from the working mask because the timeout has been processed */
-			kernel_tcbs_working_mask &= ~(1U << (tcb->priority - 1));
+		tcb = tcb_next;
+	}
+}
+
+/* Called from the Systick Handler to count down the time slice of the running thread.
+ * When the slice runs out, the thread is rotated to the tail of its priority's ready list so the next peer becomes the head.
+ * The scheduler that runs right after in the Systick Handler then only pends PendSV if the head actually changed.
+ *
+ * A thread that is alone at its priority (or has already blocked and left its ready list) returns on the first check,
+ * so it pays nothing beyond a compare and its slice counter is never touched.
+ */
+void kernel_tcb_time_slice(void)
+{
+	tcb_type* tcb = current_thread;
+
+	/* The running thread is always the head of its ready list, unless it just blocked and PendSV hasn't run yet.
+	 * The NULL check covers Systick firing before kernel_run() has started the first thread.
+	 */
+	if ((tcb == (tcb_type*)0U) || (tcb != kernel_tcbs[tcb->priority]) || (tcb->next == tcb)) {
+		return;
+	}
+
+	/* A slice of 0 means time slicing is turned off for this thread */
+	if ((tcb->slice != 0U) && (--tcb->slice == 0U)) {
+		tcb->slice = tcb->quantum;
+
+		/* The list is circular, so moving the head forward by one puts the old head at the tail */
+		kernel_tcbs[tcb->priority] = tcb->next;
+	}
+}
+
+#if KERNEL_BUDGET
+/* Called from the Systick Handler to hold the running job against its budget, so a runaway job is caught within a tick.
+ * Only the first overrun of a job is reported, and a thread that just blocked has already had its job closed.
+ */
+void kernel_tcb_budget_check(void)
+{
+	tcb_type* tcb = current_thread;
+	uint32_t used;
+
+	if ((tcb == (tcb_type*)0U) || (tcb->budget == 0U) || (tcb->state != KERNEL_TCB_READY)
+		|| (tcb->budget_state != KERNEL_BUDGET_STATE_NONE)) {
+		return;
+	}
+
+	used = tcb->budget_used + (DWT->CYCCNT - tcb->budget_start);
+	if (used > tcb->budget) {
+		kernel_budget_overrun(tcb, used, 0U);
+	}
+}
+
+/* Close the job of the current thread as it blocks, with interrupts disabled.
+ * A demoted thread goes back to its base priority, it can't hold a resource while it blocks.
+ * The few cycles until PendSV actually switches away are charged to the next job.
+ */
+static void kernel_tcb_budget_end(tcb_type* tcb)
+{
+	uint32_t now = DWT->CYCCNT;
+	uint32_t used = tcb->budget_used + (now - tcb->budget_start);
+
+	if (used > tcb->budget_max) {
+		tcb->budget_max = used;
+	}
+
+	if ((tcb->budget != 0U) && (used > tcb->budget) && (tcb->budget_state == KERNEL_BUDGET_STATE_NONE)) {
+		kernel_budget_overrun(tcb, used, 1U);
+	}
+
+	if (tcb->budget_state == KERNEL_BUDGET_STATE_DEMOTED) {
+		tcb->budget_state = KERNEL_BUDGET_STATE_NONE;
+		kernel_tcb_restore_priority(tcb);
+	}
+
+	tcb->budget_state = KERNEL_BUDGET_STATE_NONE;
+	tcb->budget_used = 0U;
+	tcb->budget_start = now;
+}
+
+/* Called by the PendSV Handler right before current_thread becomes next_thread, with interrupts disabled */
+static void __attribute__((used)) kernel_budget_switch(void)
+{
+	uint32_t now = DWT->CYCCNT;
+
+	if (current_thread != (tcb_type*)0U) {
+		current_thread->budget_used += now - current_thread->budget_start;
+	}
+	next_thread->budget_start = now;
+}
+#endif
+
+/* Add a thread to the tail of its priority's ready list and mark the priority as ready.
+ * The tail of a circular list is the node right before the head.
+ * Must be called inside of a critical section or from the Systick Handler.
+ */
+static void kernel_tcb_ready_insert(tcb_type* tcb)
+{
+	tcb_type* head = kernel_tcbs[tcb->priority];
+
+	tcb->slice = tcb->quantum;
+	tcb->state = KERNEL_TCB_READY;
+
+	if (head == (tcb_type*)0U) {
+		tcb->next = tcb;
+		tcb->prev = tcb;
+		kernel_tcbs[tcb->priority] = tcb;
+		kernel_bitmap_set(&kernel_tcbs_ready_mask, tcb->priority);
+	} else {
+		tcb->next = head;
+		tcb->prev = head->prev;
+		head->prev->next = tcb;
+		head->prev = tcb;
+	}
+}
+
+/* Take a thread out of its priority's ready list.
+ * The ready bit for the priority is only cleared once the last thread at that priority is removed.
+ */
+static void kernel_tcb_ready_remove(tcb_type* tcb)
+{
+	if (tcb->next == tcb) {
+		kernel_tcbs[tcb->priority] = (tcb_type*)0U;
+		kernel_bitmap_clear(&kernel_tcbs_ready_mask, tcb->priority);
+	} else {
+		tcb->prev->next = tcb->next;
+		tcb->next->prev = tcb->prev;
+
+		if (kernel_tcbs[tcb->priority] == tcb) {
+			kernel_tcbs[tcb->priority] = tcb->next;
 		}
 	}
 }
 
+/* The delayed list is a plain NULL terminated doubly linked list, new threads are pushed to the front */
+static void kernel_tcb_delayed_insert(tcb_type* tcb)
+{
+	tcb->prev = (tcb_type*)0U;
+	tcb->next = kernel_tcbs_delayed;
+
+	if (kernel_tcbs_delayed != (tcb_type*)0U) {
+		kernel_tcbs_delayed->prev = tcb;
+	}
+	kernel_tcbs_delayed = tcb;
+}
+
+static void kernel_tcb_delayed_remove(tcb_type* tcb)
+{
+	if (tcb->prev != (tcb_type*)0U) {
+		tcb->prev->next = tcb->next;
+	} else {
+		kernel_tcbs_delayed = tcb->next;
+	}
+
+	if (tcb->next != (tcb_type*)0U) {
+		tcb->next->prev = tcb->prev;
+	}
+}
+
+/* Unlink a thread from the wait list of the kernel object it is blocked on, if any */
+static void kernel_tcb_wait_remove(tcb_type* tcb)
+{
+	if (tcb->wait_list == (tcb_type**)0U) {
+		return;
+	}
+
+	if (tcb->wait_prev != (tcb_type*)0U) {
+		tcb->wait_prev->wait_next = tcb->wait_next;
+	} else {
+		*tcb->wait_list = tcb->wait_next;
+	}
+
+	if (tcb->wait_next != (tcb_type*)0U) {
+		tcb->wait_next->wait_prev = tcb->wait_prev;
+	}
+
+	tcb->wait_list = (tcb_type**)0U;
+}
+
+#if KERNEL_CRITICAL_TRACE
+/* Call site name the PendSV Handler records for its own critical section */
+static const char kernel_critical_pendsv[] __attribute__((used)) = "PendSV_Handler";
+#endif
+
 static void kernel_on_idle(void)
 {
 	led_green_toggle();
@@ -261,19 +690,31 @@ static void kernel_on_idle(void)
  * It was assisted by writing the desired C code logic first, then triggering the PendSV manually and using the
  * 	compiler generated ASM code as the base.
  *
+ * Threads run on the process stack (PSP) and every handler runs on the main stack (MSP), so a thread stack only ever
+ * 	holds the thread itself plus one exception frame, and interrupts, tasks and the kernel share the one main stack.
+ *
  * The logic for the PendSV Handler is as follows:
  * 1) Disable interrupts
- * 2) Check if theres a current thread running. If there is, Push the context by saving R4-R11 and saving the SP to current TCB's SP.
- * 3) Load the next thread and set the current thread to the next thread.
- * 4) Load the SP for the now new current thread into the processor's SP.
- * 5) Restore the context of the new current thread by popping registers R4-R11.
- * 6) Enable interrupts.
- * 7) Branch to the next thread.
+ * 2) Check if theres a current thread running. If there is, store R4-R11 below its exception frame on the PSP and save
+ * 	the PSP to current TCB's SP.
+ * 3) Load the next thread and set the current thread to the next thread. With KERNEL_BUDGET, charge the switch first.
+ * 4) Load the SP for the now new current thread, restore its R4-R11 from it and put what is left in to the PSP.
+ * 5) Enable interrupts.
+ * 6) Return to thread mode on the PSP, which branches to the next thread.
  */
 __attribute__((naked)) void PendSV_Handler(void)
 {
 	/* __disable__irq(); */
 	__asm("CPSID	I");
+
+#if KERNEL_CRITICAL_TRACE
+	/* kernel_critical_start = DWT->CYCCNT; R0 - R3 were stacked by the exception entry so they are free to use */
+	__asm("LDR     R0, =0xE0001004");
+	__asm("LDR     R0, [R0, #0]");
+	__asm("LDR     R1, =kernel_critical_start");
+	__asm("STR     R0, [R1, #0]");
+#endif
+
 	__asm("LDR    R3, =current_thread");
 
 
@@ -282,38 +723,70 @@ __attribute__((naked)) void PendSV_Handler(void)
 	__asm("CMP     R3, #0");
 	__asm("BEQ.N   PendSV_Restore");
 
-	/* Save R4 - R11 */
-	__asm("PUSH	{R4-R11}");
+	/* Save R4 - R11 on the thread's stack, below the frame the exception entry stacked on the PSP */
+	__asm("MRS     R0, PSP");
+	__asm("STMDB   R0!, {R4-R11}");
 
-	/* current_thread->sp = sp;
-	 * Save the current SP in to current_thread->sp
+	/* current_thread->sp = psp;
+	 * Save the thread's stack pointer in to current_thread->sp
 	 */
 	__asm("LDR     R3, =current_thread");
 	__asm("LDR	   R3, [R3, #0]");
-	__asm("STR     SP, [R3, #0]");
+	__asm("STR     R0, [R3, #0]");
 
 	/* current_thread = next_thread; */
 	__asm("PendSV_Restore:");
+
+#if KERNEL_BUDGET
+	/* kernel_budget_switch(); R4 is free once it is saved, or unused before the first thread, so it keeps the EXC_RETURN */
+	__asm("MOV     R4, LR");
+	__asm("BL      kernel_budget_switch");
+	__asm("MOV     LR, R4");
+#endif
+
 	__asm("LDR     R3, =next_thread");
 	__asm("LDR     R3, [R3, #0]");
 	__asm("LDR     R2, =current_thread");
 	__asm("STR     R3, [R2, #0]");
 
-	/* sp = current_thread->sp;
-	 * Note: Since SP is a special-purpose register, you have to use LDR instruction.
-	 * 		 Replaced "STR [R3, #0], SP" with
-	 * 		 		  "LDR SP, [R3, #0]"
+	/* psp = current_thread->sp;
+	 * Note: The PSP is a special-purpose register, so it is loaded through R0 and written with MSR.
 	 */
 	__asm("LDR     R3, =current_thread");	/* Load the address of current thread */
 	__asm("LDR     R3, [R3, #0]");			/* Load the value of current thread (pointer to TCB) */
-	__asm("LDR     SP, [R3, #0]");			/* Load the SP from TCB into the stack pointer */
+	__asm("LDR     R0, [R3, #0]");			/* Load the SP from TCB */
 
-	/* Restore R4-R11 */
-	__asm("POP	 {R4-R11}");
+	/* Restore R4-R11, the exception frame left above them is unstacked from the PSP on return */
+	__asm("LDMIA   R0!, {R4-R11}");
+	__asm("MSR     PSP, R0");
+
+#if KERNEL_CRITICAL_TRACE
+	/* cycles = DWT->CYCCNT - kernel_critical_start;
+	 * if (cycles > kernel_critical_max.cycles_max) record it with this handler as the call site, line 0
+	 */
+	__asm("LDR     R0, =0xE0001004");
+	__asm("LDR     R0, [R0, #0]");
+	__asm("LDR     R1, =kernel_critical_start");
+	__asm("LDR     R1, [R1, #0]");
+	__asm("SUBS    R0, R0, R1");
+	__asm("LDR     R1, =kernel_critical_max");
+	__asm("LDR     R2, [R1, #0]");
+	__asm("CMP     R0, R2");
+	__asm("BLS.N   PendSV_Exit");
+	__asm("STR     R0, [R1, #0]");
+	__asm("LDR     R2, =kernel_critical_pendsv");
+	__asm("STR     R2, [R1, #4]");
+	__asm("MOVS    R2, #0");
+	__asm("STR     R2, [R1, #8]");
+	__asm("PendSV_Exit:");
+#endif
 
 	/* __enable_irq(); */
 	__asm("CPSIE   I");
 
-	/* return to the next thread */
+	/* return to the next thread, in thread mode on the PSP: EXC_RETURN 0xFFFFFFFD.
+	 * The first switch comes from main() on the MSP, so the EXC_RETURN PendSV was entered with can't be used as is.
+	 */
+	__asm("MVN     LR, #2");
 	__asm("BX	LR");
 }
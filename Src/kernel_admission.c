@@ -0,0 +1,244 @@
+#include <stdint.h>
+#include "kernel.h"
+#include "kernel_admission.h"
+#include "kernel_bitmap.h"
+#include "kernel_critical.h"
+#include "kernel_semaphore.h"
+#include "systick.h"
+
+static void kernel_admission_rank(void);
+static uint32_t kernel_admission_response(const kernel_admission_type* me);
+#if KERNEL_ADMISSION_TEST == KERNEL_ADMISSION_TEST_UTILIZATION
+static uint32_t kernel_admission_bounded(void);
+static uint32_t kernel_admission_utilization(void);
+#endif
+
+/* Admitted threads in admission order. The thread under test is appended while it is tested and taken off again if
+ * 	it is rejected. Only admissions touch the list, and they are serialized by the lock so the test itself doesn't
+ * 	have to run with interrupts masked. The lock never blocks before kernel_run(), there is only main() then.
+ */
+static kernel_admission_type* kernel_admission_list;
+static kernel_semaphore_type kernel_admission_lock = {1U, (tcb_type*)0U};
+
+void kernel_admission_initialize(
+	kernel_admission_type* me,
+	uint32_t period,
+	uint32_t deadline,
+	uint32_t wcet,
+	uint32_t blocking)
+{
+	me->tcb = (tcb_type*)0U;
+	me->period = period;
+	me->deadline = (deadline != 0U) ? deadline : period;
+	me->wcet = wcet;
+	me->blocking = blocking;
+	me->response = 0U;
+	me->automatic = 0U;
+	me->priority = 0U;
+	me->candidate = 0U;
+	me->next = (kernel_admission_type*)0U;
+}
+
+/* Function to test a thread against the admitted set and start it if the set stays schedulable.
+ * Runs the test from the calling thread, so it costs time but doesn't hold off interrupts. Only the priority moves of
+ * 	already running automatic threads happen inside a critical section. They move the base priority, so a thread that
+ * 	holds a resource ceiling or is demoted right now only moves once it would have gone back to its old priority.
+ */
+kernel_status_type kernel_admission_start(
+	kernel_admission_type* me,
+	tcb_type* tcb,
+	uint8_t priority,
+	tcb_type_handler tcb_handler,
+	void* argument,
+	void* stack_array,
+	uint32_t stack_size)
+{
+	uint32_t primask;
+	kernel_status_type status = KERNEL_OK;
+	uint8_t exact = 1U;
+	kernel_admission_type** link;
+	kernel_admission_type* entry;
+
+	/* Response times are kept in 32 bits, which limits deadlines to about 268 seconds at 16 MHz */
+	if ((me->period == 0U) || (me->wcet == 0U) || (me->deadline > me->period)
+		|| (me->deadline > (0xFFFFFFFFU / SYSTICK_CYCLES_PER_TICK)) || ((uint32_t)priority > KERNEL_PRIORITY_MAX)) {
+		return KERNEL_INVALID;
+	}
+
+	(void)kernel_semaphore_take(&kernel_admission_lock, KERNEL_WAIT_FOREVER);
+
+	me->tcb = tcb;
+	me->automatic = (priority == KERNEL_ADMISSION_PRIORITY_AUTO);
+	me->priority = priority;
+	me->next = (kernel_admission_type*)0U;
+	for (link = &kernel_admission_list; *link != (kernel_admission_type*)0U; link = &(*link)->next) {}
+	*link = me;
+
+	kernel_admission_rank();
+
+	for (entry = kernel_admission_list; entry != (kernel_admission_type*)0U; entry = entry->next) {
+		if (entry->candidate == 0U) {
+			status = KERNEL_INVALID;
+		}
+	}
+
+#if KERNEL_ADMISSION_TEST == KERNEL_ADMISSION_TEST_UTILIZATION
+	/* The bound says nothing about sets it wasn't derived for, those take the exact test instead */
+	if (kernel_admission_bounded() != 0U) {
+		exact = 0U;
+		if ((status == KERNEL_OK) && (kernel_admission_utilization() == 0U)) {
+			status = KERNEL_REJECTED;
+		}
+	}
+#endif
+
+	/* A new thread can push every thread at or below its priority past its deadline, so all of them are tested */
+	for (entry = kernel_admission_list; (exact != 0U) && (status == KERNEL_OK) && (entry != (kernel_admission_type*)0U);
+		entry = entry->next) {
+		if (kernel_admission_response(entry) == 0U) {
+			status = KERNEL_REJECTED;
+		}
+	}
+
+	if (status != KERNEL_OK) {
+		*link = (kernel_admission_type*)0U;
+		kernel_semaphore_give(&kernel_admission_lock);
+		return status;
+	}
+
+	/* Commit. Moving a running thread only changes the list it sits on, the scheduler then picks up the new order. */
+	primask = kernel_critical_enter();
+	for (entry = kernel_admission_list; entry != me; entry = entry->next) {
+		if (entry->priority != entry->candidate) {
+			kernel_tcb_set_base_priority(entry->tcb, entry->candidate);
+			entry->priority = entry->candidate;
+		}
+	}
+	me->priority = me->candidate;
+	if (kernel_tcb_current() != (tcb_type*)0U) {
+		kernel_scheduler_priority_based();
+	}
+	kernel_critical_exit(primask);
+
+	for (entry = kernel_admission_list; entry != (kernel_admission_type*)0U; entry = entry->next) {
+		entry->response = (exact != 0U) ? kernel_admission_response(entry) : 0U;
+	}
+
+	kernel_tcb_start_argument(tcb, me->priority, tcb_handler, argument, stack_array, stack_size);
+
+	kernel_semaphore_give(&kernel_admission_lock);
+
+	return KERNEL_OK;
+}
+
+/* Give every thread on the list the priority it would have with the new thread admitted.
+ * Automatic threads are ranked deadline monotonic, ties go to the shorter period and then to the earlier admission.
+ * 	A rank that falls out of the band leaves the candidate priority at 0.
+ */
+static void kernel_admission_rank(void)
+{
+	kernel_admission_type* entry;
+	kernel_admission_type* other;
+
+	for (entry = kernel_admission_list; entry != (kernel_admission_type*)0U; entry = entry->next) {
+		uint32_t rank = 0U;
+		uint8_t before = 1U;
+
+		if (entry->automatic == 0U) {
+			entry->candidate = entry->priority;
+			continue;
+		}
+
+		for (other = kernel_admission_list; other != (kernel_admission_type*)0U; other = other->next) {
+			if (other == entry) {
+				before = 0U;
+			} else if ((other->automatic != 0U)
+				&& ((other->deadline < entry->deadline)
+					|| ((other->deadline == entry->deadline) && (other->period < entry->period))
+					|| ((other->deadline == entry->deadline) && (other->period == entry->period) && (before != 0U)))) {
+				rank++;
+			}
+		}
+
+		entry->candidate = (rank <= (KERNEL_ADMISSION_PRIORITY_HIGHEST - KERNEL_ADMISSION_PRIORITY_LOWEST))
+			? (uint8_t)(KERNEL_ADMISSION_PRIORITY_HIGHEST - rank) : 0U;
+	}
+}
+
+/* Worst case response time in cycles of a thread at its candidate priority, or 0 if it passes the deadline.
+ * Fixed point iteration of R = B + C + ceil(R / tick) * tick overhead + sum over every other thread at the same or a
+ * 	higher priority of ceil(R / T) * C, where every C includes two context switches. Deadlines are at most the
+ * 	period, so the first job after a critical instant is the worst one.
+ */
+static uint32_t kernel_admission_response(const kernel_admission_type* me)
+{
+	uint64_t deadline = (uint64_t)me->deadline * SYSTICK_CYCLES_PER_TICK;
+	uint64_t cost = (uint64_t)me->wcet + (2U * KERNEL_ADMISSION_SWITCH_OVERHEAD);
+	uint64_t response = me->blocking + cost;
+
+	while (1) {
+		const kernel_admission_type* other;
+		uint64_t demand = me->blocking + cost
+			+ (((response + SYSTICK_CYCLES_PER_TICK - 1U) / SYSTICK_CYCLES_PER_TICK) * KERNEL_ADMISSION_TICK_OVERHEAD);
+
+		for (other = kernel_admission_list; other != (kernel_admission_type*)0U; other = other->next) {
+			if ((other != me) && (other->candidate >= me->candidate)) {
+				uint64_t period = (uint64_t)other->period * SYSTICK_CYCLES_PER_TICK;
+
+				demand += ((response + period - 1U) / period)
+					* ((uint64_t)other->wcet + (2U * KERNEL_ADMISSION_SWITCH_OVERHEAD));
+			}
+		}
+
+		if (demand > deadline) {
+			return 0U;
+		}
+		if (demand == response) {
+			return (uint32_t)response;
+		}
+		response = demand;
+	}
+}
+
+#if KERNEL_ADMISSION_TEST == KERNEL_ADMISSION_TEST_UTILIZATION
+/* Returns 1 if the hyperbolic bound applies to the set under test: every thread has an automatic priority, which is
+ * 	rate monotonic once deadlines equal periods, and nothing blocks.
+ */
+static uint32_t kernel_admission_bounded(void)
+{
+	const kernel_admission_type* entry;
+
+	for (entry = kernel_admission_list; entry != (kernel_admission_type*)0U; entry = entry->next) {
+		if ((entry->automatic == 0U) || (entry->deadline != entry->period) || (entry->blocking != 0U)) {
+			return 0U;
+		}
+	}
+
+	return 1U;
+}
+
+/* Hyperbolic bound in 16.16 fixed point, with the Systick Handler as one more periodic load. Returns 1 if it holds.
+ * Every utilization and product is rounded up, so the fixed point can only make the test stricter.
+ */
+static uint32_t kernel_admission_utilization(void)
+{
+	const kernel_admission_type* entry;
+	uint64_t product = 1ULL << 16;
+
+	product = ((product * ((1ULL << 16)
+		+ ((((uint64_t)KERNEL_ADMISSION_TICK_OVERHEAD << 16) + SYSTICK_CYCLES_PER_TICK - 1U) / SYSTICK_CYCLES_PER_TICK)))
+		+ 0xFFFFU) >> 16;
+
+	for (entry = kernel_admission_list; entry != (kernel_admission_type*)0U; entry = entry->next) {
+		uint64_t cost = (uint64_t)entry->wcet + (2U * KERNEL_ADMISSION_SWITCH_OVERHEAD);
+		uint64_t period = (uint64_t)entry->period * SYSTICK_CYCLES_PER_TICK;
+
+		product = ((product * ((1ULL << 16) + (((cost << 16) + period - 1U) / period))) + 0xFFFFU) >> 16;
+		if (product > (2ULL << 16)) {
+			return 0U;
+		}
+	}
+
+	return 1U;
+}
+#endif
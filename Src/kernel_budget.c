@@ -0,0 +1,119 @@
+#include <stdint.h>
+#include "kernel.h"
+#include "kernel_budget.h"
+#include "kernel_critical.h"
+
+#if KERNEL_BUDGET
+static void kernel_budget_apply(tcb_type* tcb);
+
+static kernel_budget_handler kernel_budget_overrun_handler;
+
+void kernel_budget_set(tcb_type* tcb, uint32_t budget, kernel_budget_policy_type policy)
+{
+	uint32_t primask;
+
+	primask = kernel_critical_enter();
+	tcb->budget = budget;
+	tcb->budget_policy = (uint8_t)policy;
+	kernel_critical_exit(primask);
+}
+
+void kernel_budget_set_handler(kernel_budget_handler handler)
+{
+	uint32_t primask;
+
+	primask = kernel_critical_enter();
+	kernel_budget_overrun_handler = handler;
+	kernel_critical_exit(primask);
+}
+
+/* Function to let a suspended thread continue. The overrun is forgiven, the rest of its job gets a whole budget. */
+void kernel_budget_resume(tcb_type* tcb)
+{
+	uint32_t primask;
+
+	primask = kernel_critical_enter();
+	if (tcb->budget_state == KERNEL_BUDGET_STATE_SUSPENDED) {
+		tcb->budget_state = KERNEL_BUDGET_STATE_NONE;
+		tcb->budget_used = 0U;
+		kernel_tcb_wake(tcb, KERNEL_OK);
+		if (kernel_tcb_current() != (tcb_type*)0U) {
+			kernel_scheduler_priority_based();
+		}
+	}
+	kernel_critical_exit(primask);
+}
+
+/* Function to read the budget metrics of a thread. The running job only counts once it has ended or overrun. */
+void kernel_budget_stats(const tcb_type* tcb, kernel_budget_stats_type* stats)
+{
+	uint32_t primask;
+
+	primask = kernel_critical_enter();
+	stats->budget = tcb->budget;
+	stats->execution_max = tcb->budget_max;
+	stats->overruns = tcb->budget_overruns;
+	kernel_critical_exit(primask);
+}
+
+void kernel_budget_reset(tcb_type* tcb)
+{
+	uint32_t primask;
+
+	primask = kernel_critical_enter();
+	tcb->budget_max = 0U;
+	tcb->budget_overruns = 0U;
+	kernel_critical_exit(primask);
+}
+
+/* Function the kernel calls once per overrunning job, from the Systick Handler while the job still runs or from
+ * 	kernel_tcb_wait() when it has finished. A finished job is only counted and reported, there is nothing left to stop.
+ * Demotion and suspension leave the rescheduling to the scheduler call at the end of the Systick Handler. While the
+ * 	job holds a resource they are put off until kernel_resource_unlock() releases the last one.
+ */
+void kernel_budget_overrun(tcb_type* tcb, uint32_t used, uint8_t finished)
+{
+	tcb->budget_overruns++;
+	if (used > tcb->budget_max) {
+		tcb->budget_max = used;
+	}
+	tcb->budget_state = KERNEL_BUDGET_STATE_OVERRUN;
+
+	if (kernel_budget_overrun_handler != (kernel_budget_handler)0U) {
+		kernel_budget_overrun_handler(tcb, used);
+	}
+
+	if ((finished != 0U) || (tcb->budget_policy == KERNEL_BUDGET_CALLBACK)) {
+		return;
+	}
+
+	if (tcb->locks != 0U) {
+		tcb->budget_state = KERNEL_BUDGET_STATE_DEFERRED;
+	} else {
+		kernel_budget_apply(tcb);
+	}
+}
+
+void kernel_budget_release(tcb_type* tcb)
+{
+	if (tcb->budget_state == KERNEL_BUDGET_STATE_DEFERRED) {
+		tcb->budget_state = KERNEL_BUDGET_STATE_OVERRUN;
+		kernel_budget_apply(tcb);
+	}
+}
+
+/* Demote or suspend an overrunning job that holds no resource */
+static void kernel_budget_apply(tcb_type* tcb)
+{
+	if (tcb->budget_policy == KERNEL_BUDGET_DEMOTE) {
+		/* A thread already at or below the background priority has nowhere to go */
+		if (tcb->priority > KERNEL_BUDGET_BACKGROUND_PRIORITY) {
+			kernel_tcb_set_priority(tcb, KERNEL_BUDGET_BACKGROUND_PRIORITY);
+			tcb->budget_state = KERNEL_BUDGET_STATE_DEMOTED;
+		}
+	} else if (tcb->budget_policy == KERNEL_BUDGET_SUSPEND) {
+		kernel_tcb_suspend(tcb);
+		tcb->budget_state = KERNEL_BUDGET_STATE_SUSPENDED;
+	}
+}
+#endif
@@ -0,0 +1,42 @@
+#include <stdint.h>
+#include "stm32f407xx.h"
+#include "kernel_critical.h"
+
+#if KERNEL_CRITICAL_TRACE
+kernel_critical_stats_type kernel_critical_max;
+uint32_t kernel_critical_start;
+const char* kernel_critical_function;
+uint32_t kernel_critical_line;
+#endif
+
+/* Function to read the longest critical section so far. The copy is taken with interrupts masked so it can't tear,
+ * 	without going through the tracking itself. Always reports zero when tracing is compiled out.
+ */
+void kernel_critical_stats(kernel_critical_stats_type* stats)
+{
+#if KERNEL_CRITICAL_TRACE
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	*stats = kernel_critical_max;
+	__set_PRIMASK(primask);
+#else
+	stats->cycles_max = 0U;
+	stats->function = (const char*)0U;
+	stats->line = 0U;
+#endif
+}
+
+/* Function to forget the longest critical section, for example after start up so only steady state is measured */
+void kernel_critical_reset(void)
+{
+#if KERNEL_CRITICAL_TRACE
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	kernel_critical_max.cycles_max = 0U;
+	kernel_critical_max.function = (const char*)0U;
+	kernel_critical_max.line = 0U;
+	__set_PRIMASK(primask);
+#endif
+}
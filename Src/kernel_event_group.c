@@ -0,0 +1,131 @@
+#include <stdint.h>
+#include "kernel.h"
+#include "kernel_critical.h"
+#include "kernel_event_group.h"
+
+static uint32_t kernel_event_group_satisfied(uint32_t flags, uint32_t bits, uint8_t options);
+
+void kernel_event_group_initialize(kernel_event_group_type* me)
+{
+	me->flags = 0U;
+	me->waiters = (tcb_type*)0U;
+}
+
+/* Function to set bits in the event group, safe to call from an ISR.
+ * With nobody waiting this is just an OR inside of a critical section.
+ * Otherwise every waiter is checked against the same flag value, all satisfied waiters are woken up, and only then
+ * 	are the clear on exit bits removed and the scheduler called. This way one set wakes any number of threads with a
+ * 	single reschedule instead of one per waiter.
+ * Returns the flags as they were right after the set, before any clear on exit.
+ */
+uint32_t kernel_event_group_set(kernel_event_group_type* me, uint32_t bits)
+{
+	uint32_t primask;
+	uint32_t flags;
+	uint32_t clear_bits = 0U;
+	uint32_t woken = 0U;
+	tcb_type* tcb;
+
+	primask = kernel_critical_enter();
+
+	flags = me->flags | bits;
+	me->flags = flags;
+
+	tcb = me->waiters;
+	while (tcb != (tcb_type*)0U) {
+		/* Waking a thread unlinks it from the wait list, so save the next pointer first */
+		tcb_type* tcb_next = tcb->wait_next;
+
+		if (kernel_event_group_satisfied(flags, tcb->wait_mask, tcb->wait_options)) {
+			/* The waiter gets to see the flags that satisfied it */
+			tcb->wait_value = flags;
+			if ((tcb->wait_options & KERNEL_EVENT_GROUP_CLEAR_ON_EXIT) != 0U) {
+				clear_bits |= tcb->wait_mask;
+			}
+
+			kernel_tcb_wake(tcb, KERNEL_OK);
+			woken = 1U;
+		}
+
+		tcb = tcb_next;
+	}
+
+	me->flags = flags & ~clear_bits;
+
+	if (woken != 0U) {
+		kernel_scheduler_priority_based();
+	}
+
+	kernel_critical_exit(primask);
+
+	return flags;
+}
+
+/* Function to clear bits in the event group. Clearing bits can never satisfy a waiter so no one is woken up.
+ * Returns the flags as they were before the clear.
+ */
+uint32_t kernel_event_group_clear(kernel_event_group_type* me, uint32_t bits)
+{
+	uint32_t primask;
+	uint32_t flags;
+
+	primask = kernel_critical_enter();
+	flags = me->flags;
+	me->flags = flags & ~bits;
+	kernel_critical_exit(primask);
+
+	return flags;
+}
+
+uint32_t kernel_event_group_get(kernel_event_group_type* me)
+{
+	return me->flags;
+}
+
+/* Function to wait for bits in the event group.
+ * options is a combination of the KERNEL_EVENT_GROUP_* defines, timeout is in ticks with KERNEL_WAIT_FOREVER never timing out.
+ * Returns the flags that satisfied the wait, or 0 if the wait timed out. Since a satisfied wait always has at least one
+ * 	of the requested bits set, 0 can never be mistaken for a successful wait.
+ * Must only be called from a thread, never from an ISR or the idle thread.
+ */
+uint32_t kernel_event_group_wait(kernel_event_group_type* me, uint32_t bits, uint8_t options, uint32_t timeout)
+{
+	uint32_t primask;
+	uint32_t flags;
+	tcb_type* tcb;
+
+	/* Checking the flags and blocking must happen in the same critical section, otherwise an ISR could set the bits
+	 * 	in between and the thread would sleep through its own event.
+	 */
+	primask = kernel_critical_enter();
+
+	flags = me->flags;
+	if (kernel_event_group_satisfied(flags, bits, options)) {
+		if ((options & KERNEL_EVENT_GROUP_CLEAR_ON_EXIT) != 0U) {
+			me->flags = flags & ~bits;
+		}
+	} else {
+		tcb = kernel_tcb_current();
+		tcb->wait_mask = bits;
+		tcb->wait_options = options;
+
+		if (kernel_tcb_wait(&me->waiters, timeout) == KERNEL_OK) {
+			flags = tcb->wait_value;
+		} else {
+			flags = 0U;
+		}
+	}
+
+	kernel_critical_exit(primask);
+
+	return flags;
+}
+
+static uint32_t kernel_event_group_satisfied(uint32_t flags, uint32_t bits, uint8_t options)
+{
+	if ((options & KERNEL_EVENT_GROUP_WAIT_ALL) != 0U) {
+		return ((flags & bits) == bits) && (bits != 0U);
+	}
+
+	return (flags & bits) != 0U;
+}
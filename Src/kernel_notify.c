@@ -0,0 +1,77 @@
+#include <stdint.h>
+#include "kernel.h"
+#include "kernel_critical.h"
+#include "kernel_notify.h"
+
+/* Direct to task notifications.
+ * The notification value lives inside the receiving thread's tcb, so signalling a thread from an ISR needs no
+ * 	separate kernel object. Only one thread can ever wait on a notification: the owner of the tcb.
+ */
+
+/* Function to notify a thread, safe to call from an ISR.
+ * The notification stays pending until the thread calls kernel_notify_wait(), so a notify that happens before the
+ * 	wait is never lost. If the thread is already blocked waiting for it, it is woken up and the scheduler is called.
+ */
+void kernel_notify(tcb_type* tcb, uint32_t value, kernel_notify_mode_type mode)
+{
+	uint32_t primask;
+
+	primask = kernel_critical_enter();
+
+	switch (mode) {
+	case KERNEL_NOTIFY_SET_BITS:
+		tcb->notify_value |= value;
+		break;
+	case KERNEL_NOTIFY_INCREMENT:
+		tcb->notify_value++;
+		break;
+	case KERNEL_NOTIFY_OVERWRITE:
+	default:
+		tcb->notify_value = value;
+		break;
+	}
+	tcb->notify_pending = 1U;
+
+	/* The thread's own wait list is only non-empty while it is blocked in kernel_notify_wait().
+	 * If the wait already timed out, the kernel has unlinked it, so a late notify can't wake a thread twice.
+	 */
+	if (tcb->notify_waiter != (tcb_type*)0U) {
+		kernel_tcb_wake(tcb, KERNEL_OK);
+		kernel_scheduler_priority_based();
+	}
+
+	kernel_critical_exit(primask);
+}
+
+/* Function for the current thread to wait for a notification.
+ * Returns immediately if one is already pending. On success the notification value is stored in *value (if value is
+ * 	not NULL) and then the clear_on_exit bits are cleared from it. Pass 0xFFFFFFFF to reset the value completely,
+ * 	for example to take every count of KERNEL_NOTIFY_INCREMENT at once.
+ * Returns KERNEL_TIMEOUT if nothing arrived within timeout ticks, KERNEL_WAIT_FOREVER never times out.
+ * Must only be called from a thread, never from an ISR or the idle thread.
+ */
+kernel_status_type kernel_notify_wait(uint32_t clear_on_exit, uint32_t* value, uint32_t timeout)
+{
+	uint32_t primask;
+	kernel_status_type status = KERNEL_OK;
+	tcb_type* tcb;
+
+	primask = kernel_critical_enter();
+
+	tcb = kernel_tcb_current();
+	if (tcb->notify_pending == 0U) {
+		status = kernel_tcb_wait(&tcb->notify_waiter, timeout);
+	}
+
+	if (status == KERNEL_OK) {
+		tcb->notify_pending = 0U;
+		if (value != (uint32_t*)0U) {
+			*value = tcb->notify_value;
+		}
+		tcb->notify_value &= ~clear_on_exit;
+	}
+
+	kernel_critical_exit(primask);
+
+	return status;
+}
@@ -0,0 +1,110 @@
+#include <stdint.h>
+#include "stm32f407xx.h"
+#include "kernel.h"
+#include "kernel_critical.h"
+#include "kernel_resource.h"
+#if KERNEL_BUDGET
+#include "kernel_budget.h"
+#endif
+
+void kernel_resource_initialize(kernel_resource_type* me, uint8_t ceiling)
+{
+	me->ceiling = ceiling;
+	me->saved_priority = 0U;
+	me->saved_slice = 0U;
+	me->owner = (tcb_type*)0U;
+	me->locked_at = 0U;
+	me->hold_max = 0U;
+}
+
+/* Function to lock a resource from a thread.
+ * Moves the running thread up to the ceiling's ready list, which just sets a bit in the ready bitmap, so no scheduler
+ * 	call is needed: nothing can be ready above the running thread at a level it just raised itself to.
+ * Time slicing is turned off while the resource is held, otherwise a peer at the ceiling could run and use the resource.
+ */
+void kernel_resource_lock(kernel_resource_type* me)
+{
+	uint32_t primask;
+	tcb_type* tcb;
+
+	primask = kernel_critical_enter();
+
+	tcb = kernel_tcb_current();
+	me->owner = tcb;
+	me->saved_priority = tcb->priority;
+	me->saved_slice = tcb->slice;
+	tcb->locks++;
+
+	if (me->ceiling > tcb->priority) {
+		kernel_tcb_set_priority(tcb, me->ceiling);
+	}
+	tcb->slice = 0U;
+
+	me->locked_at = DWT->CYCCNT;
+
+	kernel_critical_exit(primask);
+}
+
+/* Function to unlock a resource.
+ * Drops the owner back to its saved priority, or to its base priority once it holds no resource at all, and calls
+ * 	the scheduler once, so any higher priority thread that became ready while the resource was held preempts right
+ * 	away. With KERNEL_BUDGET, an overrun policy that was put off while the owner held resources is applied once it
+ * 	releases the last one.
+ */
+void kernel_resource_unlock(kernel_resource_type* me)
+{
+	uint32_t primask;
+	uint32_t held;
+
+	primask = kernel_critical_enter();
+
+	held = DWT->CYCCNT - me->locked_at;
+	if (held > me->hold_max) {
+		me->hold_max = held;
+	}
+
+	/* The base priority may have been changed while the resource was held, so the outermost unlock goes back to it
+	 * 	rather than to the priority the lock saved.
+	 * Moving priority reloads the time slice, so put back what was left of it before the lock. For a nested lock that
+	 * 	is 0, which keeps slicing off until the outer lock is released too.
+	 */
+	me->owner->locks--;
+	if (me->owner->locks != 0U) {
+		kernel_tcb_set_priority(me->owner, me->saved_priority);
+	} else {
+		kernel_tcb_restore_priority(me->owner);
+	}
+	me->owner->slice = me->saved_slice;
+
+#if KERNEL_BUDGET
+	if (me->owner->locks == 0U) {
+		kernel_budget_release(me->owner);
+	}
+#endif
+	me->owner = (tcb_type*)0U;
+
+	kernel_scheduler_priority_based();
+
+	kernel_critical_exit(primask);
+}
+
+/* Function to compute the worst case blocking from a static description of which thread locks which resource.
+ * Declared hold times should come from the code's own worst case analysis, the measured hold_max only covers what
+ * 	the run so far has exercised.
+ */
+uint32_t kernel_resource_blocking(const kernel_resource_use_type* uses, uint32_t count, uint8_t priority)
+{
+	uint32_t blocking = 0U;
+	uint32_t i;
+
+	for (i = 0U; i < count; i++) {
+		const kernel_resource_use_type* use = &uses[i];
+		uint32_t hold = (use->hold != 0U) ? use->hold : use->resource->hold_max;
+
+		if ((use->priority < priority) && (use->resource->ceiling >= priority) && (hold > blocking)) {
+			blocking = hold;
+		}
+	}
+
+	return blocking;
+}
@@ -0,0 +1,61 @@
+#include <stdint.h>
+#include "kernel.h"
+#include "kernel_critical.h"
+#include "kernel_semaphore.h"
+
+void kernel_semaphore_initialize(kernel_semaphore_type* me, uint32_t count)
+{
+	me->count = count;
+	me->waiters = (tcb_type*)0U;
+}
+
+/* Function to give the semaphore, safe to call from an ISR.
+ * If threads are waiting, the count is handed straight to the highest priority waiter instead of being incremented,
+ * 	so a lower priority thread can't sneak in and take it before the woken thread gets to run.
+ */
+void kernel_semaphore_give(kernel_semaphore_type* me)
+{
+	uint32_t primask;
+	tcb_type* tcb;
+	tcb_type* highest;
+
+	primask = kernel_critical_enter();
+
+	highest = me->waiters;
+	if (highest == (tcb_type*)0U) {
+		me->count++;
+	} else {
+		for (tcb = highest->wait_next; tcb != (tcb_type*)0U; tcb = tcb->wait_next) {
+			if (tcb->priority > highest->priority) {
+				highest = tcb;
+			}
+		}
+
+		kernel_tcb_wake(highest, KERNEL_OK);
+		kernel_scheduler_priority_based();
+	}
+
+	kernel_critical_exit(primask);
+}
+
+/* Function to take the semaphore, blocking for up to timeout ticks if the count is 0.
+ * KERNEL_WAIT_FOREVER never times out.
+ * Must only be called from a thread, never from an ISR or the idle thread.
+ */
+kernel_status_type kernel_semaphore_take(kernel_semaphore_type* me, uint32_t timeout)
+{
+	uint32_t primask;
+	kernel_status_type status = KERNEL_OK;
+
+	primask = kernel_critical_enter();
+
+	if (me->count != 0U) {
+		me->count--;
+	} else {
+		status = kernel_tcb_wait(&me->waiters, timeout);
+	}
+
+	kernel_critical_exit(primask);
+
+	return status;
+}
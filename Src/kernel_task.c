@@ -0,0 +1,122 @@
+#include <stdint.h>
+#include "stm32f407xx.h"
+#include "kernel_critical.h"
+#include "kernel_task.h"
+
+static void kernel_task_level_run(uint8_t level);
+
+/* Interrupt backing each task level, slot 0 is unused so the level can index the table directly */
+static const IRQn_Type kernel_task_irqs[KERNEL_TASK_LEVELS + 1] = {
+	CAN2_TX_IRQn,
+	CAN2_TX_IRQn,
+	CAN2_RX0_IRQn,
+	CAN2_RX1_IRQn,
+	CAN2_SCE_IRQn
+};
+
+/* FIFO of activated tasks waiting to run on each level */
+static kernel_task_type* kernel_task_heads[KERNEL_TASK_LEVELS + 1];
+static kernel_task_type* kernel_task_tails[KERNEL_TASK_LEVELS + 1];
+
+/* Function to set up the task level interrupts.
+ * Systick keeps NVIC priority 0 and PendSV stays at the very bottom, the task levels sit in between with the highest
+ * 	level getting NVIC priority 1. Lower number set means higher priority.
+ */
+void kernel_task_initialize(void)
+{
+	uint8_t level;
+
+	for (level = 1U; level <= KERNEL_TASK_LEVELS; level++) {
+		NVIC_SetPriority(kernel_task_irqs[level], (KERNEL_TASK_LEVELS + 1U) - level);
+		NVIC_EnableIRQ(kernel_task_irqs[level]);
+	}
+}
+
+void kernel_task_create(kernel_task_type* me, kernel_task_handler handler, uint8_t level)
+{
+	me->handler = handler;
+	me->next = (kernel_task_type*)0U;
+	me->level = level;
+	me->pending = 0U;
+}
+
+/* Function to activate a task, safe to call from threads, ISRs and other tasks.
+ * Activating a task that is already waiting to run is coalesced in to the one pending run.
+ * Writing the interrupt number to STIR pends the level's interrupt in a single store. If the level is higher than
+ * 	whatever is running, the task preempts it as soon as interrupts are enabled again.
+ * Returns 1 if the task was queued and 0 if it was already pending.
+ */
+uint32_t kernel_task_activate(kernel_task_type* me)
+{
+	uint32_t primask;
+	uint32_t queued = 0U;
+
+	primask = kernel_critical_enter();
+
+	if (me->pending == 0U) {
+		me->pending = 1U;
+		me->next = (kernel_task_type*)0U;
+
+		if (kernel_task_tails[me->level] == (kernel_task_type*)0U) {
+			kernel_task_heads[me->level] = me;
+		} else {
+			kernel_task_tails[me->level]->next = me;
+		}
+		kernel_task_tails[me->level] = me;
+
+		NVIC->STIR = (uint32_t)kernel_task_irqs[me->level];
+		queued = 1U;
+	}
+
+	kernel_critical_exit(primask);
+
+	return queued;
+}
+
+/* Run every queued task of a level to completion, with interrupts enabled so higher levels can preempt.
+ * pending is cleared before the handler runs so a task can be activated again while it is running.
+ */
+static void kernel_task_level_run(uint8_t level)
+{
+	uint32_t primask;
+
+	while (1) {
+		kernel_task_type* task;
+
+		primask = kernel_critical_enter();
+		task = kernel_task_heads[level];
+		if (task == (kernel_task_type*)0U) {
+			kernel_critical_exit(primask);
+			break;
+		}
+
+		kernel_task_heads[level] = task->next;
+		if (kernel_task_heads[level] == (kernel_task_type*)0U) {
+			kernel_task_tails[level] = (kernel_task_type*)0U;
+		}
+		task->pending = 0U;
+		kernel_critical_exit(primask);
+
+		task->handler(task);
+	}
+}
+
+void CAN2_TX_IRQHandler(void)
+{
+	kernel_task_level_run(1U);
+}
+
+void CAN2_RX0_IRQHandler(void)
+{
+	kernel_task_level_run(2U);
+}
+
+void CAN2_RX1_IRQHandler(void)
+{
+	kernel_task_level_run(3U);
+}
+
+void CAN2_SCE_IRQHandler(void)
+{
+	kernel_task_level_run(4U);
+}
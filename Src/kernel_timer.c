@@ -0,0 +1,251 @@
+#include <stdint.h>
+#include "kernel.h"
+#include "kernel_critical.h"
+#include "kernel_notify.h"
+#include "kernel_timer.h"
+
+#define KERNEL_TIMER_SLOT_MASK	(KERNEL_TIMER_SLOTS - 1U)
+#define KERNEL_TIMER_RANGE		(1UL << (KERNEL_TIMER_LEVELS * KERNEL_TIMER_SLOT_BITS))
+
+static void kernel_timer_service(void);
+static void kernel_timer_insert(kernel_timer_type* me);
+static void kernel_timer_link(kernel_timer_type* me, kernel_timer_type** list);
+static void kernel_timer_unlink(kernel_timer_type* me);
+static void kernel_timer_cascade(uint32_t level);
+
+static kernel_timer_type* kernel_timer_wheel[KERNEL_TIMER_LEVELS][KERNEL_TIMER_SLOTS];
+static kernel_timer_type* kernel_timer_expired_head;	/* expired timers waiting for the service thread */
+static kernel_timer_type* kernel_timer_expired_tail;
+static uint32_t kernel_timer_now;					/* tick count of the wheel */
+static tcb_type* kernel_timer_service_tcb;
+
+void kernel_timer_create(kernel_timer_type* me, kernel_timer_handler callback, uint8_t options)
+{
+	me->next = (kernel_timer_type*)0U;
+	me->prev = (kernel_timer_type*)0U;
+	me->list = (kernel_timer_type**)0U;
+	me->expired_next = (kernel_timer_type*)0U;
+	me->callback = callback;
+	me->expires = 0U;
+	me->period = 0U;
+	me->options = options;
+	me->queued = 0U;
+	me->pending = 0U;
+}
+
+/* Function to (re)start a timer, safe to call from an ISR or a timer callback.
+ * The timer expires after delay ticks and then every period ticks, a period of 0 makes it a one shot timer.
+ * A delay of 0 is treated as 1 since the current tick has already been processed.
+ */
+void kernel_timer_start(kernel_timer_type* me, uint32_t delay, uint32_t period)
+{
+	uint32_t primask;
+
+	primask = kernel_critical_enter();
+
+	kernel_timer_unlink(me);
+	me->expires = kernel_timer_now + ((delay != 0U) ? delay : 1U);
+	me->period = period;
+	kernel_timer_insert(me);
+
+	kernel_critical_exit(primask);
+}
+
+/* Function to stop a timer, safe to call from an ISR or a timer callback.
+ * A timer that already expired but whose thread callback hasn't run yet is stopped too. It stays on the expired
+ * 	queue until the service thread gets to it, which then just drops it.
+ */
+void kernel_timer_stop(kernel_timer_type* me)
+{
+	uint32_t primask;
+
+	primask = kernel_critical_enter();
+	kernel_timer_unlink(me);
+	me->pending = 0U;
+	kernel_critical_exit(primask);
+}
+
+uint32_t kernel_timer_active(const kernel_timer_type* me)
+{
+	return (me->list != (kernel_timer_type**)0U);
+}
+
+/* Called once per tick from the Systick Handler.
+ * Steps the wheel, cascades the higher levels whenever the level below wraps around, and expires every timer in the
+ * 	new level 0 slot. Auto reload timers are filed again relative to their old expiry so they never drift.
+ */
+void kernel_timer_tick(void)
+{
+	uint32_t primask;
+	kernel_timer_type** slot;
+	uint32_t level;
+	uint32_t wake = 0U;
+
+	primask = kernel_critical_enter();
+
+	kernel_timer_now++;
+
+	/* Level n + 1 only needs a cascade when all the slot bits of levels 0 to n have wrapped to 0 */
+	for (level = 1U; level < KERNEL_TIMER_LEVELS; level++) {
+		if ((kernel_timer_now & ((1UL << (level * KERNEL_TIMER_SLOT_BITS)) - 1U)) != 0U) {
+			break;
+		}
+		kernel_timer_cascade(level);
+	}
+
+	slot = &kernel_timer_wheel[0][kernel_timer_now & KERNEL_TIMER_SLOT_MASK];
+	while (*slot != (kernel_timer_type*)0U) {
+		kernel_timer_type* timer = *slot;
+
+		kernel_timer_unlink(timer);
+
+		if (timer->period != 0U) {
+			timer->expires += timer->period;
+			kernel_timer_insert(timer);
+		}
+
+		if ((timer->options & KERNEL_TIMER_ISR_CALLBACK) != 0U) {
+			timer->callback(timer);
+		} else {
+			/* Queue it for the service thread. Expiries that happen before the callback got to run are coalesced
+			 * 	in to one call, like a notification count would be.
+			 */
+			timer->pending = 1U;
+			if (timer->queued == 0U) {
+				timer->queued = 1U;
+				timer->expired_next = (kernel_timer_type*)0U;
+				if (kernel_timer_expired_tail != (kernel_timer_type*)0U) {
+					kernel_timer_expired_tail->expired_next = timer;
+				} else {
+					kernel_timer_expired_head = timer;
+				}
+				kernel_timer_expired_tail = timer;
+				wake = 1U;
+			}
+		}
+	}
+
+	kernel_critical_exit(primask);
+
+	if ((wake != 0U) && (kernel_timer_service_tcb != (tcb_type*)0U)) {
+		kernel_notify(kernel_timer_service_tcb, 0U, KERNEL_NOTIFY_INCREMENT);
+	}
+}
+
+void kernel_timer_service_start(tcb_type* service, uint8_t priority, void* stack_array, uint32_t stack_size)
+{
+	kernel_timer_service_tcb = service;
+
+	kernel_tcb_start(
+		service,
+		priority,
+		&kernel_timer_service,
+		stack_array,
+		stack_size);
+}
+
+/* Timer service thread body, runs the callbacks of the expired timers at thread priority */
+static void kernel_timer_service(void)
+{
+	uint32_t primask;
+
+	while (1) {
+		kernel_timer_type* timer;
+		uint8_t pending = 0U;
+
+		primask = kernel_critical_enter();
+		timer = kernel_timer_expired_head;
+		if (timer != (kernel_timer_type*)0U) {
+			kernel_timer_expired_head = timer->expired_next;
+			if (kernel_timer_expired_head == (kernel_timer_type*)0U) {
+				kernel_timer_expired_tail = (kernel_timer_type*)0U;
+			}
+			pending = timer->pending;
+			timer->pending = 0U;
+			timer->queued = 0U;
+		}
+		kernel_critical_exit(primask);
+
+		if (timer == (kernel_timer_type*)0U) {
+			(void)kernel_notify_wait(0xFFFFFFFFU, (uint32_t*)0U, KERNEL_WAIT_FOREVER);
+		} else if (pending != 0U) {
+			timer->callback(timer);
+		}
+	}
+}
+
+/* File a timer in the level whose range covers the time left until it expires.
+ * The slot index is taken from the expiry itself, not the delta, so a timer cascades down exactly when the wheel
+ * 	reaches its window.
+ */
+static void kernel_timer_insert(kernel_timer_type* me)
+{
+	uint32_t delta = me->expires - kernel_timer_now;
+	uint32_t expires = me->expires;
+	uint32_t level;
+
+	/* Too far out for the wheel, park it in the last slot the wheel can reach. It is re-filed from its real expiry
+	 * 	every time it cascades down.
+	 */
+	if (delta >= KERNEL_TIMER_RANGE) {
+		expires = kernel_timer_now + (KERNEL_TIMER_RANGE - 1U);
+		delta = KERNEL_TIMER_RANGE - 1U;
+	}
+
+	for (level = 0U; level < (KERNEL_TIMER_LEVELS - 1U); level++) {
+		if (delta < (1UL << ((level + 1U) * KERNEL_TIMER_SLOT_BITS))) {
+			break;
+		}
+	}
+
+	kernel_timer_link(me, &kernel_timer_wheel[level][(expires >> (level * KERNEL_TIMER_SLOT_BITS)) & KERNEL_TIMER_SLOT_MASK]);
+}
+
+/* Move every timer of the current slot on a level back through kernel_timer_insert(), which files it in a lower level */
+static void kernel_timer_cascade(uint32_t level)
+{
+	kernel_timer_type** slot = &kernel_timer_wheel[level][(kernel_timer_now >> (level * KERNEL_TIMER_SLOT_BITS)) & KERNEL_TIMER_SLOT_MASK];
+	kernel_timer_type* timer = *slot;
+
+	*slot = (kernel_timer_type*)0U;
+
+	while (timer != (kernel_timer_type*)0U) {
+		kernel_timer_type* timer_next = timer->next;
+
+		timer->list = (kernel_timer_type**)0U;
+		kernel_timer_insert(timer);
+		timer = timer_next;
+	}
+}
+
+/* Timer lists are NULL terminated doubly linked lists, new timers are pushed to the front */
+static void kernel_timer_link(kernel_timer_type* me, kernel_timer_type** list)
+{
+	me->list = list;
+	me->prev = (kernel_timer_type*)0U;
+	me->next = *list;
+
+	if (*list != (kernel_timer_type*)0U) {
+		(*list)->prev = me;
+	}
+	*list = me;
+}
+
+static void kernel_timer_unlink(kernel_timer_type* me)
+{
+	if (me->list == (kernel_timer_type**)0U) {
+		return;
+	}
+
+	if (me->prev != (kernel_timer_type*)0U) {
+		me->prev->next = me->next;
+	} else {
+		*me->list = me->next;
+	}
+
+	if (me->next != (kernel_timer_type*)0U) {
+		me->next->prev = me->prev;
+	}
+
+	me->list = (kernel_timer_type**)0U;
+}
@@ -0,0 +1,130 @@
+#include <stdint.h>
+#include "stm32f407xx.h"
+#include "kernel.h"
+#include "kernel_critical.h"
+#include "kernel_work_queue.h"
+
+static void kernel_work_queue_worker(kernel_work_queue_type* me);
+
+void kernel_work_initialize(kernel_work_type* work, kernel_work_handler handler)
+{
+	work->handler = handler;
+	work->next = (kernel_work_type*)0U;
+	work->submitted = 0U;
+	work->pending = 0U;
+}
+
+void kernel_work_queue_initialize(kernel_work_queue_type* me)
+{
+	me->head = (kernel_work_type*)0U;
+	me->tail = (kernel_work_type*)0U;
+	me->workers = (tcb_type*)0U;
+	me->latency_max = 0U;
+	me->coalesced = 0U;
+}
+
+/* Function to start a worker thread for a queue. The worker's priority is the priority the deferred work runs at.
+ * Several workers can serve the same queue, each submit wakes the highest priority idle worker.
+ */
+void kernel_work_queue_start_worker(
+	kernel_work_queue_type* me,
+	tcb_type* worker,
+	uint8_t priority,
+	void* stack_array,
+	uint32_t stack_size)
+{
+	kernel_tcb_start_argument(
+		worker,
+		priority,
+		(tcb_type_handler)&kernel_work_queue_worker,
+		me,
+		stack_array,
+		stack_size);
+}
+
+/* Function to defer a work item to the queue's worker threads, meant to be called from an ISR.
+ * Only links the item in and wakes a worker, so the ISR stays a handful of instructions.
+ * If the item is still pending from an earlier submit nothing is queued, since the one pending run will see the
+ * 	latest state anyway.
+ * Returns 1 if the item was queued and 0 if it was coalesced.
+ */
+uint32_t kernel_work_submit(kernel_work_queue_type* me, kernel_work_type* work)
+{
+	uint32_t primask;
+	uint32_t queued = 0U;
+	tcb_type* worker;
+	tcb_type* highest;
+
+	primask = kernel_critical_enter();
+
+	if (work->pending != 0U) {
+		me->coalesced++;
+	} else {
+		work->pending = 1U;
+		work->submitted = DWT->CYCCNT;
+		work->next = (kernel_work_type*)0U;
+
+		if (me->tail == (kernel_work_type*)0U) {
+			me->head = work;
+		} else {
+			me->tail->next = work;
+		}
+		me->tail = work;
+		queued = 1U;
+
+		/* Wake the highest priority idle worker if there is one, otherwise a busy worker picks the item up when it
+		 * 	loops around. The wait list is in blocking order, so it has to be searched like a semaphore's.
+		 */
+		highest = me->workers;
+		if (highest != (tcb_type*)0U) {
+			for (worker = highest->wait_next; worker != (tcb_type*)0U; worker = worker->wait_next) {
+				if (worker->priority > highest->priority) {
+					highest = worker;
+				}
+			}
+
+			kernel_tcb_wake(highest, KERNEL_OK);
+			kernel_scheduler_priority_based();
+		}
+	}
+
+	kernel_critical_exit(primask);
+
+	return queued;
+}
+
+/* Worker thread body, the queue arrives as the thread argument.
+ * pending is cleared before the handler runs, so a submit that happens while the handler is running queues the item
+ * 	again and no event is ever missed.
+ */
+static void kernel_work_queue_worker(kernel_work_queue_type* me)
+{
+	uint32_t primask;
+
+	while (1) {
+		kernel_work_type* work;
+		uint32_t latency;
+
+		primask = kernel_critical_enter();
+
+		while (me->head == (kernel_work_type*)0U) {
+			(void)kernel_tcb_wait(&me->workers, KERNEL_WAIT_FOREVER);
+		}
+
+		work = me->head;
+		me->head = work->next;
+		if (me->head == (kernel_work_type*)0U) {
+			me->tail = (kernel_work_type*)0U;
+		}
+		work->pending = 0U;
+
+		latency = DWT->CYCCNT - work->submitted;
+		if (latency > me->latency_max) {
+			me->latency_max = latency;
+		}
+
+		kernel_critical_exit(primask);
+
+		work->handler(work);
+	}
+}
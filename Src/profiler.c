@@ -0,0 +1,114 @@
+#include "profiler.h"
+
+#if PROFILER_ENABLE
+
+#include <stdint.h>
+#include <stdio.h>
+#include "stm32f407xx.h"
+#include "kernel.h"
+
+#define PROFILER_TIMER_CLOCK	16000000U	/* APB1 timer clock, running from the 16 MHz HSI */
+#define PROFILER_COUNT_CLOCK	1000000U	/* TIM7 counts in microseconds */
+
+/* Kept global so the samples can also be pulled out with the debugger when there is no serial output.
+ * The oldest sample sits profiler_count slots before profiler_head, wrapping around the end of the buffer.
+ */
+profiler_sample_type profiler_samples[PROFILER_SAMPLES];
+volatile uint32_t profiler_head;			/* slot the next sample goes in to */
+volatile uint32_t profiler_count;			/* samples in the buffer, at most PROFILER_SAMPLES */
+volatile uint32_t profiler_overwritten;		/* older samples the ring has written over since the last dump */
+
+/* Function to start sampling with TIM7, a basic timer nothing else in the project uses.
+ * The interrupt runs at priority 0 next to the Systick so it can sample every other handler as well, but code that
+ * 	runs with interrupts disabled is only seen at the point where interrupts are enabled again.
+ */
+void profiler_start(void)
+{
+	RCC->APB1ENR |= RCC_APB1ENR_TIM7EN;
+
+	TIM7->CR1 = 0U;
+	TIM7->PSC = (PROFILER_TIMER_CLOCK / PROFILER_COUNT_CLOCK) - 1U;
+	TIM7->ARR = (PROFILER_COUNT_CLOCK / PROFILER_RATE_HZ) - 1U;
+	TIM7->CNT = 0U;
+
+	/* Load the prescaler now instead of at the first update, then clear the update flag that causes */
+	TIM7->EGR = TIM_EGR_UG;
+	TIM7->SR = 0U;
+	TIM7->DIER = TIM_DIER_UIE;
+
+	NVIC_SetPriority(TIM7_IRQn, 0U);
+	NVIC_EnableIRQ(TIM7_IRQn);
+
+	TIM7->CR1 = TIM_CR1_CEN;
+}
+
+void profiler_stop(void)
+{
+	TIM7->CR1 = 0U;
+	NVIC_DisableIRQ(TIM7_IRQn);
+}
+
+/* Function to print every sample oldest first and empty the buffer, the output format is what
+ * 	Tools/profiler_symbolize.py reads. Sampling is paused while printing so the dump doesn't profile itself.
+ */
+void profiler_dump(void)
+{
+	uint32_t i;
+	uint32_t count;
+	uint32_t slot;
+
+	NVIC_DisableIRQ(TIM7_IRQn);
+
+	count = profiler_count;
+	slot = (profiler_head + PROFILER_SAMPLES - count) % PROFILER_SAMPLES;
+
+	printf("profile,%lu,%lu,%lu\r\n",
+		(unsigned long)PROFILER_RATE_HZ,
+		(unsigned long)count,
+		(unsigned long)profiler_overwritten);
+
+	for (i = 0U; i < count; i++) {
+		printf("sample,%08lx,%08lx\r\n",
+			(unsigned long)profiler_samples[slot].pc,
+			(unsigned long)(uint32_t)profiler_samples[slot].tcb);
+
+		slot = ((slot + 1U) == PROFILER_SAMPLES) ? 0U : (slot + 1U);
+	}
+
+	printf("end\r\n");
+
+	profiler_count = 0U;
+	profiler_overwritten = 0U;
+
+	NVIC_EnableIRQ(TIM7_IRQn);
+}
+
+/* Called from the handler below with the exception frame of the interrupted code, the stacked PC is word 6 */
+static __attribute__((used)) void profiler_sample(uint32_t* frame)
+{
+	uint32_t head = profiler_head;
+
+	TIM7->SR = 0U;
+
+	profiler_samples[head].pc = frame[6];
+	profiler_samples[head].tcb = kernel_tcb_current();
+	profiler_head = ((head + 1U) == PROFILER_SAMPLES) ? 0U : (head + 1U);
+
+	if (profiler_count < PROFILER_SAMPLES) {
+		profiler_count++;
+	} else {
+		profiler_overwritten++;
+	}
+}
+
+/* Bit 2 of EXC_RETURN tells where the interrupted code stacked its frame: the PSP for a thread, the MSP for a handler */
+__attribute__((naked)) void TIM7_IRQHandler(void)
+{
+	__asm("TST     LR, #4");
+	__asm("ITE     EQ");
+	__asm("MRSEQ   R0, MSP");
+	__asm("MRSNE   R0, PSP");
+	__asm("B       profiler_sample");
+}
+
+#endif /* PROFILER_ENABLE */
@@ -0,0 +1,205 @@
+#include <stdint.h>
+#include "stm32f407xx.h"
+#include "kernel.h"
+#include "kernel_critical.h"
+#include "kernel_notify.h"
+#include "ring_buffer.h"
+#include "systick.h"
+
+/* Function to set up a ring buffer over caller provided memory.
+ * The size is rounded down to a power of two if it isn't one already, so some of the memory may go unused.
+ */
+void ring_buffer_initialize(ring_buffer_type* me, uint8_t* buffer, uint32_t size)
+{
+	me->buffer = buffer;
+	me->mask = (size != 0U) ? ((1U << (31U - (uint32_t)__builtin_clz(size))) - 1U) : 0U;
+	me->head = 0U;
+	me->tail = 0U;
+	me->consumer = (tcb_type*)0U;
+	me->consumer_waiting = 0U;
+}
+
+uint32_t ring_buffer_count(const ring_buffer_type* me)
+{
+	return me->head - me->tail;
+}
+
+uint32_t ring_buffer_space(const ring_buffer_type* me)
+{
+	return (me->mask + 1U) - (me->head - me->tail);
+}
+
+/* Function for the producer to get the largest contiguous free region without copying anything.
+ * Write in to *span and then hand the bytes over with ring_buffer_write_commit().
+ * Returns the number of bytes available at *span, which stops at the end of the buffer even if there is more room
+ * 	after wrapping around, so call it again after committing to get the rest.
+ */
+uint32_t ring_buffer_write_span(ring_buffer_type* me, uint8_t** span)
+{
+	uint32_t head = me->head;
+	uint32_t space = (me->mask + 1U) - (head - me->tail);
+	uint32_t to_end = (me->mask + 1U) - (head & me->mask);
+
+	/* The consumer must be done reading the bytes it released before the producer writes over them */
+	__DMB();
+
+	*span = &me->buffer[head & me->mask];
+	return (space < to_end) ? space : to_end;
+}
+
+/* Function for the producer to publish bytes written in to a span.
+ * The barrier makes sure the data is in memory before the consumer can see the new head.
+ * If the consumer is asleep in ring_buffer_wait() it is notified.
+ */
+void ring_buffer_write_commit(ring_buffer_type* me, uint32_t length)
+{
+	__DMB();
+	me->head = me->head + length;
+
+	/* Pairs with the barrier in ring_buffer_wait(). Either the consumer sees the new head before it goes to sleep,
+	 * 	or the producer sees consumer_waiting and sends the notification, so a wake up can never be lost.
+	 */
+	__DMB();
+	if ((me->consumer_waiting != 0U) && (me->consumer != (tcb_type*)0U)) {
+		kernel_notify(me->consumer, RING_BUFFER_NOTIFY_BIT, KERNEL_NOTIFY_SET_BITS);
+	}
+}
+
+/* Function for the producer to copy bytes in. Returns how many bytes fit, which may be less than length. */
+uint32_t ring_buffer_push(ring_buffer_type* me, const uint8_t* data, uint32_t length)
+{
+	uint32_t pushed = 0U;
+
+	/* At most two spans, one up to the end of the buffer and one from the start after wrapping around */
+	while (pushed < length) {
+		uint8_t* span;
+		uint32_t span_length = ring_buffer_write_span(me, &span);
+		uint32_t i;
+
+		if (span_length == 0U) {
+			break;
+		}
+		if (span_length > (length - pushed)) {
+			span_length = length - pushed;
+		}
+
+		for (i = 0; i < span_length; i++) {
+			span[i] = data[pushed + i];
+		}
+		pushed += span_length;
+
+		ring_buffer_write_commit(me, span_length);
+	}
+
+	return pushed;
+}
+
+/* Function for the consumer to get the largest contiguous region of unread bytes without copying anything.
+ * Read from *span and then give the bytes back with ring_buffer_read_release().
+ */
+uint32_t ring_buffer_read_span(ring_buffer_type* me, const uint8_t** span)
+{
+	uint32_t tail = me->tail;
+	uint32_t count = me->head - tail;
+	uint32_t to_end = (me->mask + 1U) - (tail & me->mask);
+
+	/* The new head must be read before the data it covers */
+	__DMB();
+
+	*span = &me->buffer[tail & me->mask];
+	return (count < to_end) ? count : to_end;
+}
+
+/* Function for the consumer to free bytes it has finished reading.
+ * The barrier makes sure every read is done before the producer is allowed to reuse the memory.
+ */
+void ring_buffer_read_release(ring_buffer_type* me, uint32_t length)
+{
+	__DMB();
+	me->tail = me->tail + length;
+}
+
+/* Function for the consumer to copy bytes out. Returns how many bytes were available, which may be less than length. */
+uint32_t ring_buffer_pop(ring_buffer_type* me, uint8_t* data, uint32_t length)
+{
+	uint32_t popped = 0U;
+
+	while (popped < length) {
+		const uint8_t* span;
+		uint32_t span_length = ring_buffer_read_span(me, &span);
+		uint32_t i;
+
+		if (span_length == 0U) {
+			break;
+		}
+		if (span_length > (length - popped)) {
+			span_length = length - popped;
+		}
+
+		for (i = 0; i < span_length; i++) {
+			data[popped + i] = span[i];
+		}
+		popped += span_length;
+
+		ring_buffer_read_release(me, span_length);
+	}
+
+	return popped;
+}
+
+/* Function for a consumer thread to sleep until the ring buffer has data in it.
+ * Uses the RING_BUFFER_NOTIFY_BIT of the thread's own notification, so no other kernel object is needed. Only that bit
+ * 	is consumed: notifications from other sources stay pending for the thread's own kernel_notify_wait(), and they
+ * 	only cost this wait a spurious wake up.
+ * The timeout is a deadline taken once on entry, wake ups without data wait out the rest of it, not a new one.
+ * Returns KERNEL_OK once there is data, or KERNEL_TIMEOUT if nothing arrived in time.
+ * Must only be called from a thread, never from an ISR or the idle thread.
+ */
+kernel_status_type ring_buffer_wait(ring_buffer_type* me, uint32_t timeout)
+{
+	uint32_t primask;
+	kernel_status_type status = KERNEL_OK;
+	uint64_t deadline = systick_tick_count() + timeout;
+	tcb_type* tcb = kernel_tcb_current();
+
+	me->consumer = tcb;
+	me->consumer_waiting = 1U;
+
+	/* Publish consumer_waiting before looking at head, pairs with the barrier in ring_buffer_write_commit() */
+	__DMB();
+
+	primask = kernel_critical_enter();
+
+	/* A notification left over from an earlier wake up can return early with nothing new, so check again */
+	while ((me->head == me->tail) && (status == KERNEL_OK)) {
+		uint32_t remaining = KERNEL_WAIT_FOREVER;
+
+		if (timeout != KERNEL_WAIT_FOREVER) {
+			uint64_t now = systick_tick_count();
+
+			if (now >= deadline) {
+				status = KERNEL_TIMEOUT;
+				break;
+			}
+			remaining = (uint32_t)(deadline - now);
+		}
+
+		if ((tcb->notify_value & RING_BUFFER_NOTIFY_BIT) == 0U) {
+			status = kernel_tcb_wait(&tcb->notify_waiter, remaining);
+		}
+
+		/* The notification only stops being pending when nothing but the ring buffer bit was in it */
+		if ((tcb->notify_value & RING_BUFFER_NOTIFY_BIT) != 0U) {
+			tcb->notify_value &= ~RING_BUFFER_NOTIFY_BIT;
+			if (tcb->notify_value == 0U) {
+				tcb->notify_pending = 0U;
+			}
+		}
+	}
+
+	kernel_critical_exit(primask);
+
+	me->consumer_waiting = 0U;
+
+	return status;
+}
@@ -2,16 +2,25 @@
 #include "stm32f407xx.h"
 #include "systick.h"
 #include "kernel.h"
+#include "kernel_critical.h"
+#include "kernel_timer.h"
 #include "led.h"
 
-#define SYSTEM_CLOCK 		16000000	/* 16 MHz */
+#define SYSTEM_CLOCK 		SYSTICK_SYSTEM_CLOCK
 #define TRIGGER_EVERY_SEC	SYSTEM_CLOCK
-#define TRIGGER_EVERY_MS	(SYSTEM_CLOCK / 1000U)
+#define TRIGGER_EVERY_MS	SYSTICK_CYCLES_PER_TICK
 
-static uint32_t get_tick_counter(void);
+static uint32_t systick_delay_can_sleep(void);
 
+/* Monotonic 64 bit tick count, split in two words that only the Systick Handler writes.
+ * tick_counter_global is the low word, so code that only needs a wrapping 32 bit count can keep reading it directly.
+ */
+volatile uint32_t tick_counter_global;
+static volatile uint32_t tick_counter_high;
 
-uint32_t tick_counter_global;
+/* Cost of sleeping through systick_delay(), SYSTICK_DELAY_SWITCH_CYCLES until the first sleep has measured it */
+static uint32_t systick_delay_switch_cycles = SYSTICK_DELAY_SWITCH_CYCLES;
+static uint8_t systick_delay_calibrated;
 
 void systick_initialize(void)
 {
@@ -32,43 +41,174 @@ void systick_initialize(void)
 
 	/* Enable Systick module */
 	SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+	/* Start the DWT cycle counter for the short busy wait delays */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0U;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 }
 
 void SysTick_Handler(void)
 {
+	uint32_t primask;
+
 	//led_green_toggle();
 
+	/* Count the tick first so every kernel path below already sees the new time */
+	tick_counter_global++;
+	if (tick_counter_global == 0U) {
+		tick_counter_high++;
+	}
+
 	/* Doesn't need to run inside of a critical section because an interrupt cannot be pre-empted by a thread.
 	 * This means no thread will be able to possibly modify the values of the kernel_tcbs[] while this runs
 	 */
 	kernel_tcb_permit();
 
+	/* Step the software timer wheel, ISR callbacks run from here and the rest are handed to the timer service thread */
+	kernel_timer_tick();
+
+	/* Rotate the running thread behind its equal priority peers once its time slice has run out */
+	kernel_tcb_time_slice();
+
+#if KERNEL_BUDGET
+	/* Apply the overrun policy before the scheduler, so a demoted or suspended thread is switched away right here */
+	kernel_tcb_budget_check();
+#endif
+
 	/* Remember the scheduler needs to be called inside of a critical section to avoid race conditions */
-	__disable_irq();
+	primask = kernel_critical_enter();
 	kernel_scheduler_priority_based();
-	__enable_irq();
+	kernel_critical_exit(primask);
 }
 
+/* Function to wait at least delay milliseconds, sleeping when it can. See systick_delay() */
 void systick_delay_ms(uint32_t delay)
 {
-	/* Start variable is used as the starting reference point to calculate the correct delay.
-	 * The current tick_counter is repeatedly checked minus "start" variable to know when the delay
-	 * 	has finished.
-	 */
-	uint32_t start = get_tick_counter();
-	while (get_tick_counter() - start <= delay){}
+	while (delay > 1000000U) {
+		systick_delay(1000000U * 1000U);
+		delay -= 1000000U;
+	}
+	systick_delay(delay * 1000U);
 }
 
-static uint32_t get_tick_counter(void)
+/* Function to busy wait at least the given number of core clock cycles on the DWT cycle counter.
+ * Works anywhere, including ISRs and critical sections, but never gives the CPU away. The call itself costs a handful
+ * 	of cycles on top, so very short waits come out slightly long.
+ */
+void systick_delay_cycles(uint32_t cycles)
 {
-	uint32_t tick_counter_local;
-	/*	uint32_t tick_counter_local;*/
-	/* Return the tick counter variable inside of a critical section.
-	 * This is so the systick interrupt cannot preempt this function and modify the value while it is being read.
-	 */
-	__disable_irq();
-	tick_counter_local = tick_counter_global;
-	__enable_irq();
+	uint32_t start = DWT->CYCCNT;
+
+	while ((DWT->CYCCNT - start) < cycles) {}
+}
+
+/* Function to busy wait at least delay microseconds, split in to one second waits so the cycle count can't overflow */
+void systick_delay_us(uint32_t delay)
+{
+	while (delay > 1000000U) {
+		systick_delay_cycles(1000000U * SYSTICK_CYCLES_PER_US);
+		delay -= 1000000U;
+	}
+	systick_delay_cycles(delay * SYSTICK_CYCLES_PER_US);
+}
+
+/* Function to wait at least delay microseconds, picking between sleeping and spinning.
+ * A thread can only sleep in whole ticks and waking it back up costs a context switch, so the delay is only slept when
+ * 	it is longer than a tick plus the switch cost. The thread blocks for the whole ticks that fit and spins off the
+ * 	rest against the monotonic clock, so the delay stays accurate to the cycle counter instead of to the tick.
+ * 	From an ISR, a critical section, or before the kernel runs, it always spins.
+ * The first sleep calibrates the switch cost, as how far past its tick boundary the thread got the CPU back. A sample
+ * 	longer than a tick means something of higher priority ran in between, it is thrown away and the next sleep tries
+ * 	again.
+ */
+void systick_delay(uint32_t delay)
+{
+	uint64_t deadline = systick_cycle_count() + ((uint64_t)delay * SYSTICK_CYCLES_PER_US);
+
+	if (systick_delay_can_sleep() != 0U) {
+		uint64_t now = systick_cycle_count();
+
+		if ((deadline > now) && ((deadline - now) >= (SYSTICK_CYCLES_PER_TICK + systick_delay_switch_cycles))) {
+			/* Blocking for n ticks wakes on the n-th tick boundary, which is at most n ticks away, so this never
+			 * 	oversleeps. It always blocks for at least one tick since 0 would mean forever.
+			 */
+			uint32_t ticks = (uint32_t)((deadline - now - systick_delay_switch_cycles) / SYSTICK_CYCLES_PER_TICK);
+			uint64_t boundary = (systick_tick_count() + ticks) * SYSTICK_CYCLES_PER_TICK;
 
-	return tick_counter_local;
+			kernel_tcb_block(ticks);
+
+			if (systick_delay_calibrated == 0U) {
+				uint64_t late = systick_cycle_count() - boundary;
+
+				if (late < SYSTICK_CYCLES_PER_TICK) {
+					systick_delay_switch_cycles = (uint32_t)late;
+					systick_delay_calibrated = 1U;
+				}
+			}
+		}
+	}
+
+	while (systick_cycle_count() < deadline) {}
+}
+
+/* Function to read the 64 bit tick count without masking interrupts, safe to call from an ISR.
+ * The two halves can't be read in one instruction, so the high word is read again afterwards. If the Systick Handler
+ * 	carried in to it in between, the read is simply retried. Inside an ISR or a critical section the Systick Handler
+ * 	can't run at all, so the first read is always consistent.
+ */
+uint64_t systick_tick_count(void)
+{
+	uint32_t high;
+	uint32_t low;
+
+	do {
+		high = tick_counter_high;
+		low = tick_counter_global;
+	} while (high != tick_counter_high);
+
+	return ((uint64_t)high << 32) | low;
+}
+
+/* Function to read the monotonic time in core clock cycles since systick_initialize(), safe to call from an ISR.
+ * Combines the tick count with the Systick counter, which counts down from TRIGGER_EVERY_MS - 1 within each tick.
+ * If the counter already wrapped but the Systick Handler hasn't run yet because the caller has interrupts masked,
+ * 	the tick is still pending in the ICSR. That tick is added by hand and the counter is read again, since the first
+ * 	read may have come from before the wrap.
+ * If the Systick Handler preempts the read instead, the tick count changes and the whole read is retried.
+ */
+uint64_t systick_cycle_count(void)
+{
+	uint64_t ticks;
+	uint32_t value;
+	uint32_t pending;
+
+	do {
+		ticks = systick_tick_count();
+		value = SysTick->VAL;
+		pending = SCB->ICSR & SCB_ICSR_PENDSTSET_Msk;
+		if (pending != 0U) {
+			value = SysTick->VAL;
+		}
+	} while (ticks != systick_tick_count());
+
+	if (pending != 0U) {
+		ticks++;
+	}
+
+	return (ticks * TRIGGER_EVERY_MS) + ((TRIGGER_EVERY_MS - 1U) - value);
+}
+
+/* Function to read the monotonic time in microseconds since systick_initialize(), safe to call from an ISR */
+uint64_t systick_time_us(void)
+{
+	return systick_cycle_count() / (SYSTEM_CLOCK / 1000000U);
+}
+
+/* Sleeping is only possible from a thread with interrupts enabled, once the kernel is running */
+static uint32_t systick_delay_can_sleep(void)
+{
+	return (__get_IPSR() == 0U)
+		&& (__get_PRIMASK() == 0U)
+		&& (kernel_tcb_current() != (tcb_type*)0U);
 }
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""Turn the output of profiler_dump() in to a flat profile and a per thread breakdown.
+
+Usage:
+    profiler_symbolize.py Debug/rtos_from_scratch.elf capture.log [--top 20]
+
+The log is the serial output of the board, other lines in it are ignored and several dumps are added together.
+Sampled PCs are mapped to the function symbols of the ELF file, and tcb addresses to the name of the global or static
+tcb variable they point at. Only the standard library is used, the ELF symbol table is read directly.
+"""
+
+import argparse
+import bisect
+import collections
+import struct
+import sys
+
+SHT_SYMTAB = 2
+STT_OBJECT = 1
+STT_FUNC = 2
+
+
+def read_symbols(path):
+    """Return (functions, objects), each a sorted list of (start, end, name)."""
+    with open(path, "rb") as f:
+        data = f.read()
+
+    if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+        sys.exit("%s: not a 32 bit little endian ELF file" % path)
+
+    e_shoff, = struct.unpack_from("<I", data, 0x20)
+    e_shentsize, e_shnum = struct.unpack_from("<HH", data, 0x2E)
+
+    sections = []
+    for i in range(e_shnum):
+        sections.append(struct.unpack_from("<IIIIIIIIII", data, e_shoff + i * e_shentsize))
+
+    functions = []
+    objects = []
+    for _, sh_type, _, _, sh_offset, sh_size, sh_link, _, _, sh_entsize in sections:
+        if sh_type != SHT_SYMTAB:
+            continue
+        strtab_offset = sections[sh_link][4]
+        for offset in range(sh_offset, sh_offset + sh_size, sh_entsize):
+            st_name, st_value, st_size, st_info, _, st_shndx = struct.unpack_from("<IIIBBH", data, offset)
+            kind = st_info & 0xF
+            if st_shndx == 0 or kind not in (STT_FUNC, STT_OBJECT):
+                continue
+            end = data.index(b"\0", strtab_offset + st_name)
+            name = data[strtab_offset + st_name:end].decode("ascii", "replace")
+            if kind == STT_FUNC:
+                # Clear the Thumb bit, the sampled PCs are real addresses
+                start = st_value & ~1
+                functions.append((start, start + st_size, name))
+            else:
+                objects.append((st_value, st_value + st_size, name))
+
+    functions.sort()
+    objects.sort()
+    return functions, objects
+
+
+class Lookup:
+    def __init__(self, symbols):
+        self.symbols = symbols
+        self.starts = [s[0] for s in symbols]
+
+    def __call__(self, address):
+        i = bisect.bisect_right(self.starts, address) - 1
+        if i >= 0:
+            start, end, name = self.symbols[i]
+            # Hand written assembly often has no size, so it owns everything up to the next symbol
+            if address < end or (start == end and (i + 1 == len(self.symbols) or address < self.starts[i + 1])):
+                return name
+        return "0x%08x" % address
+
+
+def read_samples(stream):
+    """Yield (pc, tcb) for every sample line of every dump in the log."""
+    for line in stream:
+        fields = line.strip().split(",")
+        if len(fields) == 3 and fields[0] == "sample":
+            try:
+                yield int(fields[1], 16), int(fields[2], 16)
+            except ValueError:
+                continue
+
+
+def print_table(title, counter, total, top):
+    print(title)
+    print("%8s %7s  %s" % ("samples", "percent", "function"))
+    for name, count in counter.most_common(top):
+        print("%8d %6.2f%%  %s" % (count, 100.0 * count / total, name))
+    print()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", help="ELF file the samples were taken from")
+    parser.add_argument("log", nargs="?", help="serial capture with the profiler_dump() output, stdin if omitted")
+    parser.add_argument("--top", type=int, default=20, help="functions listed per table (default 20)")
+    args = parser.parse_args()
+
+    functions, objects = read_symbols(args.elf)
+    function_of = Lookup(functions)
+    object_of = Lookup(objects)
+
+    if args.log:
+        with open(args.log, "r", errors="replace") as stream:
+            samples = list(read_samples(stream))
+    else:
+        samples = list(read_samples(sys.stdin))
+
+    if not samples:
+        sys.exit("no samples found")
+
+    flat = collections.Counter()
+    threads = collections.defaultdict(collections.Counter)
+    for pc, tcb in samples:
+        function = function_of(pc)
+        flat[function] += 1
+        threads["(no thread)" if tcb == 0 else object_of(tcb)][function] += 1
+
+    total = len(samples)
+    print_table("Flat profile, %d samples" % total, flat, total, args.top)
+
+    for thread, counter in sorted(threads.items(), key=lambda item: -sum(item[1].values())):
+        thread_total = sum(counter.values())
+        print_table("Thread %s, %d samples (%.2f%%)" % (thread, thread_total, 100.0 * thread_total / total),
+                    counter, thread_total, args.top)
+
+
+if __name__ == "__main__":
+    main()
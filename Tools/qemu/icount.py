@@ -0,0 +1,198 @@
+#!/usr/bin/env python3
+"""Deterministic instruction count regression check for the kernel hot paths under QEMU.
+
+Every scenario in icount_scenario.c is built twice, with a small and a large iteration count, and run on the
+netduinoplus2 machine (STM32F405, Cortex-M4) with QEMU's instruction counting plugin. The difference of the two
+counts divided by the difference of the iterations is the number of instructions per operation, with boot and
+set up cancelled out. Unlike cycle counts on an emulator, the result is exactly the same on every run.
+
+    icount.py                      build, run and compare against icount_baseline.json
+    icount.py --update             record the current numbers as the new baseline
+    icount.py --threshold 2        fail when a path grows by more than 2% (default 5%)
+    icount.py --report             only print the numbers, never compare
+
+Needs arm-none-eabi-gcc, make and qemu-system-arm built with TCG plugins. The plugin is contrib/plugins/libinsn.so
+(tests/plugin/libinsn.so in older QEMU trees), pass it with --plugin or the QEMU_INSN_PLUGIN environment variable.
+Instruction counts depend on the compiler that built the image and, to a lesser degree, on the QEMU version, so the
+baseline pins both: --update stores the first line of `arm-none-eabi-gcc --version` and `qemu-system-arm --version`
+next to the numbers, and a check only compares against a baseline recorded with the same two versions.
+
+Exit codes:
+    0  checked, no path regressed
+    1  checked, at least one path regressed
+    2  something could not be built or run
+    3  report only, nothing was checked: --report was given, there is no baseline, it lacks a path, or it was recorded
+       with a different toolchain or QEMU. This is not a pass, a gate must treat it as a failure.
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+# name, scenario number in icount_scenario.c, what one operation is
+SCENARIOS = [
+    ("context_switch", 1, "notify, wait and PendSV switch between two equal priority threads"),
+    ("tick", 2, "Systick Handler with 4 threads on the delayed list"),
+    ("block_permit", 3, "kernel_tcb_block(1), the tick that permits it and both switches"),
+]
+
+ITERATIONS_LOW = 100
+ITERATIONS_HIGH = 1100
+
+PLUGIN_LOCATIONS = [
+    "/usr/lib/qemu/plugins/libinsn.so",
+    "/usr/local/lib/qemu/plugins/libinsn.so",
+    "/usr/libexec/qemu/plugins/libinsn.so",
+]
+
+
+EXIT_PASS = 0
+EXIT_REGRESSED = 1
+EXIT_ERROR = 2
+EXIT_REPORT_ONLY = 3
+
+
+def fail(message):
+    print("icount: " + message, file=sys.stderr)
+    sys.exit(EXIT_ERROR)
+
+
+def version(command):
+    try:
+        output = subprocess.run([command, "--version"], check=True, stdout=subprocess.PIPE,
+                                universal_newlines=True).stdout
+    except (OSError, subprocess.CalledProcessError) as error:
+        fail("%s --version failed: %s" % (command, error))
+    return output.splitlines()[0].strip() if output else ""
+
+
+def find_plugin(path):
+    if path:
+        return path
+    if os.environ.get("QEMU_INSN_PLUGIN"):
+        return os.environ["QEMU_INSN_PLUGIN"]
+    for location in PLUGIN_LOCATIONS:
+        if os.path.exists(location):
+            return location
+    fail("libinsn.so not found, pass --plugin or set QEMU_INSN_PLUGIN")
+
+
+def build(scenario, iterations, extra_cflags):
+    command = ["make", "-s", "-C", HERE, "SCENARIO=%d" % scenario, "ITERATIONS=%d" % iterations]
+    if extra_cflags:
+        command.append("EXTRA_CFLAGS=" + extra_cflags)
+    if subprocess.call(command) != 0:
+        fail("build of scenario %d failed" % scenario)
+    return os.path.join(HERE, "build", "icount_%d_%d.elf" % (scenario, iterations))
+
+
+def run(qemu, machine, plugin, elf):
+    log = elf + ".log"
+    command = [
+        qemu, "-M", machine, "-nographic", "-monitor", "none", "-serial", "none",
+        "-semihosting-config", "enable=on,target=native",
+        "-kernel", elf,
+        "-plugin", plugin,
+        "-d", "plugin", "-D", log,
+    ]
+    try:
+        subprocess.run(command, check=True, timeout=60, stdout=subprocess.DEVNULL)
+    except subprocess.TimeoutExpired:
+        fail("%s did not exit, the scenario never reached its semihosting exit" % os.path.basename(elf))
+    except (OSError, subprocess.CalledProcessError) as error:
+        fail("running %s failed: %s" % (os.path.basename(elf), error))
+
+    with open(log) as f:
+        counts = [int(match) for match in re.findall(r"insns:\s*(\d+)", f.read())]
+    if not counts:
+        fail("no instruction count in %s, is the plugin libinsn.so?" % log)
+    # Older plugins print one line per vCPU, the machine only has one but add them up anyway
+    return sum(counts)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--qemu", default="qemu-system-arm")
+    parser.add_argument("--machine", default="netduinoplus2")
+    parser.add_argument("--plugin", help="path to libinsn.so")
+    parser.add_argument("--baseline", default=os.path.join(HERE, "icount_baseline.json"))
+    parser.add_argument("--threshold", type=float, default=5.0, help="allowed growth in percent (default 5)")
+    parser.add_argument("--update", action="store_true", help="write the results as the new baseline")
+    parser.add_argument("--report", action="store_true", help="only print the numbers, exits with 3")
+    parser.add_argument("--cflags", default="", help="extra compiler flags, for example -DKERNEL_PRIORITY_MAX=64")
+    args = parser.parse_args()
+
+    plugin = find_plugin(args.plugin)
+    toolchain = version("arm-none-eabi-gcc")
+    emulator = version(args.qemu)
+
+    # Anything that keeps the numbers from being compared turns the run in to a report, said once up front and again
+    # at the end so it can't be mistaken for a pass
+    report_only = None
+    baseline = {}
+    if args.report:
+        report_only = "--report given"
+    elif args.update:
+        pass
+    elif not os.path.exists(args.baseline):
+        report_only = "no baseline at %s, record one with --update and commit it" % args.baseline
+    else:
+        with open(args.baseline) as f:
+            recorded = json.load(f)
+        if (recorded.get("toolchain") != toolchain) or (recorded.get("qemu") != emulator):
+            report_only = "baseline recorded with %r and %r, this run uses %r and %r" % (
+                recorded.get("toolchain"), recorded.get("qemu"), toolchain, emulator)
+        else:
+            baseline = recorded.get("paths", {})
+
+    if report_only:
+        print("icount: REPORT ONLY, nothing is checked: " + report_only)
+
+    results = {}
+    regressed = False
+    missing = []
+
+    print("%-16s %12s %12s %8s  %s" % ("path", "instructions", "baseline", "change", "operation"))
+    for name, scenario, description in SCENARIOS:
+        low = run(args.qemu, args.machine, plugin, build(scenario, ITERATIONS_LOW, args.cflags))
+        high = run(args.qemu, args.machine, plugin, build(scenario, ITERATIONS_HIGH, args.cflags))
+        per_operation = (high - low) / float(ITERATIONS_HIGH - ITERATIONS_LOW)
+        results[name] = round(per_operation, 2)
+
+        if report_only:
+            print("%-16s %12.2f %12s %8s  %s" % (name, per_operation, "-", "-", description))
+        elif name in baseline:
+            change = 100.0 * (per_operation - baseline[name]) / baseline[name]
+            status = "%+7.2f%%" % change
+            if change > args.threshold:
+                status += " REGRESSED"
+                regressed = True
+            print("%-16s %12.2f %12.2f %s  %s" % (name, per_operation, baseline[name], status, description))
+        else:
+            missing.append(name)
+            print("%-16s %12.2f %12s %8s  %s" % (name, per_operation, "-", "-", description))
+
+    if args.update:
+        with open(args.baseline, "w") as f:
+            json.dump({"toolchain": toolchain, "qemu": emulator, "paths": results}, f, indent=4, sort_keys=True)
+            f.write("\n")
+        print("baseline written to %s" % args.baseline)
+        return EXIT_PASS
+
+    if missing and not report_only:
+        report_only = "no baseline for %s, record one with --update and commit it" % ", ".join(missing)
+
+    if report_only:
+        print("icount: REPORT ONLY, nothing was checked: " + report_only)
+        return EXIT_REPORT_ONLY
+
+    return EXIT_REGRESSED if regressed else EXIT_PASS
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,132 @@
+#include <stdint.h>
+#include "stm32f407xx.h"
+#include "kernel.h"
+#include "kernel_notify.h"
+
+/* Scheduler scenarios for the instruction count runner, built by Tools/qemu/Makefile and run under QEMU.
+ * Each image repeats one kernel path ICOUNT_ITERATIONS times and then ends the emulation through semihosting.
+ * The runner builds every scenario with two iteration counts and divides the difference of the instruction counts
+ * 	by the difference of the iterations, so start up and set up cancel out.
+ * The Systick is never started, ticks are pended by hand so every run takes exactly the same path.
+ */
+#define ICOUNT_SCENARIO_SWITCH			1	/* notify, wait and PendSV switch between two equal priority threads */
+#define ICOUNT_SCENARIO_TICK			2	/* one Systick Handler with ICOUNT_DELAYED threads on the delayed list */
+#define ICOUNT_SCENARIO_BLOCK_PERMIT	3	/* kernel_tcb_block(1), the tick that permits it and both switches */
+
+#ifndef ICOUNT_SCENARIO
+#define ICOUNT_SCENARIO		ICOUNT_SCENARIO_SWITCH
+#endif
+
+#ifndef ICOUNT_ITERATIONS
+#define ICOUNT_ITERATIONS	100U
+#endif
+
+#define ICOUNT_DELAYED		4U
+#define ICOUNT_FOREVER		0xFFFFFFFFU
+
+static volatile uint32_t icount_rounds;
+
+/* SYS_EXIT with ADP_Stopped_ApplicationExit, QEMU stops right here when semihosting is enabled */
+static void icount_exit(void)
+{
+	__asm volatile(
+		"MOVS    R0, #0x18\n"
+		"LDR     R1, =0x20026\n"
+		"BKPT    0xAB\n"
+		::: "r0", "r1", "memory");
+
+	while (1) {}
+}
+
+static void icount_tick(void)
+{
+	SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+	__DSB();
+	__ISB();
+}
+
+uint32_t peer_a_stack[128];
+tcb_type peer_a;
+uint32_t peer_b_stack[128];
+tcb_type peer_b;
+void main_peer(tcb_type* peer)
+{
+	while (1) {
+		(void)kernel_notify_wait(0xFFFFFFFFU, (uint32_t*)0U, KERNEL_WAIT_FOREVER);
+		if (icount_rounds == 0U) {
+			icount_exit();
+		}
+		icount_rounds--;
+		kernel_notify(peer, 0U, KERNEL_NOTIFY_INCREMENT);
+	}
+}
+
+uint32_t sleeper_stacks[ICOUNT_DELAYED][64];
+tcb_type sleepers[ICOUNT_DELAYED];
+void main_sleeper(void)
+{
+	while (1) {
+		kernel_tcb_block(ICOUNT_FOREVER);
+	}
+}
+
+uint32_t blocker_stack[128];
+tcb_type blocker;
+void main_blocker(void)
+{
+	uint32_t i;
+
+	for (i = 0U; i < ICOUNT_ITERATIONS; i++) {
+		kernel_tcb_block(1U);
+	}
+	icount_exit();
+}
+
+uint32_t driver_stack[128];
+tcb_type driver;
+void main_driver(void)
+{
+	uint32_t i;
+
+#if ICOUNT_SCENARIO == ICOUNT_SCENARIO_SWITCH
+	icount_rounds = ICOUNT_ITERATIONS;
+	kernel_notify(&peer_a, 0U, KERNEL_NOTIFY_INCREMENT);
+#elif ICOUNT_SCENARIO == ICOUNT_SCENARIO_TICK
+	for (i = 0U; i < ICOUNT_ITERATIONS; i++) {
+		icount_tick();
+	}
+	icount_exit();
+#elif ICOUNT_SCENARIO == ICOUNT_SCENARIO_BLOCK_PERMIT
+	/* Runs below the blocker, so it only gets the CPU while the blocker sleeps */
+	while (1) {
+		icount_tick();
+	}
+#endif
+
+	(void)i;
+	while (1) {
+		kernel_tcb_block(ICOUNT_FOREVER);
+	}
+}
+
+int main(void)
+{
+	uint32_t i;
+
+	kernel_initialize();
+
+#if ICOUNT_SCENARIO == ICOUNT_SCENARIO_SWITCH
+	kernel_tcb_start_argument(&peer_a, 2U, (tcb_type_handler)&main_peer, &peer_b, peer_a_stack, sizeof(peer_a_stack));
+	kernel_tcb_start_argument(&peer_b, 2U, (tcb_type_handler)&main_peer, &peer_a, peer_b_stack, sizeof(peer_b_stack));
+#elif ICOUNT_SCENARIO == ICOUNT_SCENARIO_BLOCK_PERMIT
+	kernel_tcb_start(&blocker, 2U, &main_blocker, blocker_stack, sizeof(blocker_stack));
+#endif
+
+	for (i = 0U; i < ICOUNT_DELAYED; i++) {
+		kernel_tcb_start(&sleepers[i], 3U, &main_sleeper, sleeper_stacks[i], sizeof(sleeper_stacks[i]));
+	}
+
+	kernel_tcb_start(&driver, 1U, &main_driver, driver_stack, sizeof(driver_stack));
+
+	kernel_run();
+}
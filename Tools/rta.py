@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+"""Offline response time analysis for fixed priority task sets on this kernel.
+
+Reads the task set format of Tools/sched_sim, with an optional eighth column for the blocking time:
+
+    name,priority,period_ticks,deadline_ticks,bcet_us,wcet_us,jitter_us[,blocking_us]
+
+A deadline of 0 means the deadline equals the period. '#' starts a comment. bcet_us is ignored here.
+
+The analysis is the classic busy period iteration for preemptive fixed priorities with release jitter and blocking,
+extended to deadlines longer than the period. It models this kernel:
+
+  - the Systick Handler runs every tick above every thread, costing --tick-overhead cycles
+  - every job can cost two context switches, being switched in and switched back out of, each --switch-overhead
+    cycles including the scheduler call that pended PendSV
+  - threads that share a priority are time sliced round robin, so in the worst case each one waits for all of
+    its peers as if they had a higher priority
+  - the longest kernel critical section, --critical-section cycles from kernel_critical_stats(), holds everything
+    off once per job on top of the blocking column
+
+    rta.py taskset.csv --tick-overhead 400 --switch-overhead 200 --critical-section 300
+
+For every thread it prints the worst case response time, the slack to its deadline and how many more microseconds
+of execution time it could take before any thread in the set misses. Then it prints the same for deadline
+monotonic priorities, shortest deadline highest, as a suggestion for the kernel_tcb_start() calls.
+Exits with 0 when the set is schedulable as given, 1 when it is not and 2 on bad input.
+"""
+
+import argparse
+import math
+import sys
+
+# Defaults of Inc/systick.h and Inc/kernel_bitmap.h
+SYSTEM_CLOCK = 16000000
+TICKS_PER_SECOND = 1000
+PRIORITY_MAX = 32
+
+
+class Task:
+    def __init__(self, name, priority, period, deadline, wcet, jitter, blocking):
+        self.name = name
+        self.priority = priority
+        self.period = period        # all times in core clock cycles
+        self.deadline = deadline
+        self.wcet = wcet
+        self.jitter = jitter
+        self.blocking = blocking
+
+
+def fail(message):
+    print("rta: " + message, file=sys.stderr)
+    sys.exit(2)
+
+
+def load(path, clock, tick):
+    tasks = []
+    try:
+        with open(path) as f:
+            lines = f.readlines()
+    except OSError as error:
+        fail(str(error))
+
+    for number, line in enumerate(lines, 1):
+        line = line.split("#", 1)[0].strip()
+        if not line:
+            continue
+        fields = [field.strip() for field in line.split(",")]
+        try:
+            if len(fields) not in (7, 8):
+                raise ValueError
+            name = fields[0]
+            priority = int(fields[1])
+            period = int(fields[2])
+            deadline = int(fields[3]) or period
+            wcet = float(fields[5])
+            jitter = float(fields[6])
+            blocking = float(fields[7]) if len(fields) == 8 else 0.0
+            if priority < 1 or period < 1 or wcet < 0 or jitter < 0 or blocking < 0:
+                raise ValueError
+        except ValueError:
+            fail("%s:%d: expected name,priority,period_ticks,deadline_ticks,bcet_us,wcet_us,jitter_us[,blocking_us]"
+                 % (path, number))
+
+        tasks.append(Task(name, priority, period * tick, deadline * tick,
+                          int(math.ceil(wcet * clock / 1e6)), int(math.ceil(jitter * clock / 1e6)),
+                          int(math.ceil(blocking * clock / 1e6))))
+
+    if not tasks:
+        fail("%s: no threads" % path)
+    return tasks
+
+
+def response_time(task, tasks, priorities, args):
+    """Worst case response time of task in cycles, from its nominal release, or None once it passes the deadline.
+    priorities maps every task to the priority it is analysed with.
+    """
+    switch = 2 * args.switch_overhead
+    cost = task.wcet + switch
+    blocking = task.blocking + args.critical_section
+    interferers = [other for other in tasks
+                   if other is not task and priorities[other] >= priorities[task]]
+    worst = 0
+    q = 0
+
+    # Busy period: job q of the level-i busy period finishes at w, the busy period ends once a job finishes
+    # 	before the next one is released
+    while True:
+        w = blocking + (q + 1) * cost
+        while True:
+            demand = blocking + (q + 1) * cost
+            demand += int(math.ceil(float(w) / args.tick)) * args.tick_overhead
+            for other in interferers:
+                demand += int(math.ceil(float(w + other.jitter) / other.period)) * (other.wcet + switch)
+            if demand == w:
+                break
+            w = demand
+            if w - q * task.period + task.jitter > task.deadline:
+                return None
+
+        worst = max(worst, w - q * task.period + task.jitter)
+        if w <= (q + 1) * task.period:
+            return worst
+        q += 1
+
+
+def analyse(tasks, priorities, args):
+    return dict((task, response_time(task, tasks, priorities, args)) for task in tasks)
+
+
+def schedulable(tasks, priorities, args):
+    return all(r is not None for r in analyse(tasks, priorities, args).values())
+
+
+def wcet_margin(task, tasks, priorities, args):
+    """Largest increase of the task's wcet, in cycles, that keeps every task schedulable"""
+    original = task.wcet
+    try:
+        if not schedulable(tasks, priorities, args):
+            return None
+        low = 0
+        high = 1
+        while True:
+            task.wcet = original + high
+            if not schedulable(tasks, priorities, args):
+                break
+            low = high
+            high *= 2
+            if high > 100 * args.clock:
+                return low
+        while high - low > 1:
+            middle = (low + high) // 2
+            task.wcet = original + middle
+            if schedulable(tasks, priorities, args):
+                low = middle
+            else:
+                high = middle
+        return low
+    finally:
+        task.wcet = original
+
+
+def deadline_monotonic(tasks):
+    """Shortest deadline gets the highest priority, ties go to the shorter period and then to the file order"""
+    order = sorted(enumerate(tasks), key=lambda item: (item[1].deadline, item[1].period, item[0]))
+    return dict((task, len(tasks) - rank) for rank, (_, task) in enumerate(order))
+
+
+def report(title, tasks, priorities, args):
+    us = lambda cycles: cycles * 1e6 / args.clock
+    responses = analyse(tasks, priorities, args)
+    ok = all(r is not None for r in responses.values())
+
+    print(title)
+    print("%-16s %4s %10s %10s %10s %10s %11s %10s %11s  %s" % (
+        "thread", "prio", "period_us", "deadline", "wcet_us", "block_us", "response_us", "slack_us", "margin_us",
+        "result"))
+    for task in sorted(tasks, key=lambda t: -priorities[t]):
+        response = responses[task]
+        margin = wcet_margin(task, tasks, priorities, args) if ok else None
+        print("%-16s %4d %10.1f %10.1f %10.1f %10.1f %11s %10s %11s  %s" % (
+            task.name, priorities[task], us(task.period), us(task.deadline), us(task.wcet),
+            us(task.blocking + args.critical_section),
+            "-" if response is None else "%.1f" % us(response),
+            "-" if response is None else "%.1f" % us(task.deadline - response),
+            "-" if margin is None else "%.1f" % us(margin),
+            "ok" if response is not None else "MISS"))
+    print("%s\n" % ("schedulable" if ok else "NOT schedulable"))
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("taskset")
+    parser.add_argument("--tick-overhead", type=int, default=0, help="cycles of every Systick Handler")
+    parser.add_argument("--switch-overhead", type=int, default=0,
+                        help="cycles of every context switch, scheduler and PendSV Handler")
+    parser.add_argument("--critical-section", type=int, default=0,
+                        help="cycles of the longest kernel critical section")
+    parser.add_argument("--clock", type=int, default=SYSTEM_CLOCK, help="core clock in Hz (default %d)" % SYSTEM_CLOCK)
+    parser.add_argument("--tick-rate", type=int, default=TICKS_PER_SECOND,
+                        help="ticks per second (default %d)" % TICKS_PER_SECOND)
+    parser.add_argument("--priority-max", type=int, default=PRIORITY_MAX,
+                        help="KERNEL_PRIORITY_MAX of the firmware (default %d)" % PRIORITY_MAX)
+    args = parser.parse_args()
+
+    if args.tick_rate < 1 or args.clock < args.tick_rate:
+        fail("the clock needs at least one cycle per tick")
+    args.tick = args.clock // args.tick_rate
+
+    tasks = load(args.taskset, args.clock, args.tick)
+    for task in tasks:
+        if task.priority > args.priority_max:
+            fail("%s: priority %d is above KERNEL_PRIORITY_MAX %d" % (task.name, task.priority, args.priority_max))
+
+    utilization = sum(float(t.wcet + 2 * args.switch_overhead) / t.period for t in tasks)
+    utilization += float(args.tick_overhead) / args.tick
+    print("%d threads, utilization %.1f%% with overheads, tick %d cycles + %d, switch %d, critical section %d\n" % (
+        len(tasks), 100.0 * utilization, args.tick, args.tick_overhead, args.switch_overhead, args.critical_section))
+
+    given = dict((task, task.priority) for task in tasks)
+    ok = report("Priorities as given", tasks, given, args)
+
+    suggested = deadline_monotonic(tasks)
+    if len(tasks) > args.priority_max:
+        print("deadline monotonic needs %d priorities, KERNEL_PRIORITY_MAX is %d\n" % (len(tasks), args.priority_max))
+    else:
+        report("Deadline monotonic priorities", tasks, suggested, args)
+
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,728 @@
+/* Monte-Carlo schedulability sweep for task sets on this kernel.
+ *
+ * Every trial is a discrete event simulation in virtual time, counted in core clock cycles. It replays the kernel's
+ * 	own scheduling rules: one circular ready list per priority with new threads appended at the tail, the two level
+ * 	ready bitmap from Inc/kernel_bitmap.h, time slices that rotate the head of a list on the tick, and the pick of
+ * 	kernel_scheduler_priority_based() or kernel_scheduler_round_robin() at every tick, release and completion.
+ * 	The Systick Handler and every context switch cost a configurable number of cycles.
+ *
+ * Each job of a thread is released through an interrupt at its nominal release time plus a random jitter, and runs
+ * 	for a random time between its best and worst case execution time. Response times are measured from the nominal
+ * 	release, and a job misses when it finishes after the nominal release plus the deadline. Jobs still running at
+ * 	the end of a trial only count when their deadline has passed by then.
+ *
+ * Trials are independent, seeded from the base seed and the trial number, and spread over every host core, so the
+ * 	result doesn't depend on the number of workers.
+ *
+ *     sched_sim [options] taskset.csv
+ *
+ * The task set has one thread per line, '#' starts a comment:
+ *     name,priority,period_ticks,deadline_ticks,bcet_us,wcet_us,jitter_us
+ * A deadline of 0 means the deadline equals the period. Jitter is clamped below the period. The blocking_us column
+ * 	that Tools/rta.py reads after these is ignored.
+ */
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "kernel.h"
+#include "kernel_bitmap.h"
+#include "systick.h"
+
+#define SIM_THREADS_MAX		64U
+#define SIM_NAME_LENGTH		32U
+#define SIM_NONE			0xFFU
+#define SIM_NEVER			UINT64_MAX
+
+/* Log linear histogram: exact below 16, then 16 buckets per power of two, so percentiles are within ~6% */
+#define SIM_SUB_BITS		4U
+#define SIM_SUB_BUCKETS		(1U << SIM_SUB_BITS)
+#define SIM_BUCKETS			(SIM_SUB_BUCKETS + ((64U - SIM_SUB_BITS) * SIM_SUB_BUCKETS))
+
+typedef enum {
+	SIM_POLICY_PRIORITY = 0,
+	SIM_POLICY_ROUND_ROBIN,
+	SIM_POLICIES
+} sim_policy_type;
+
+typedef struct {
+	char name[SIM_NAME_LENGTH];
+	uint8_t priority;
+	uint64_t period;			/* cycles */
+	uint64_t deadline;
+	uint64_t bcet;
+	uint64_t wcet;
+	uint64_t jitter;
+} sim_task_type;
+
+typedef struct {
+	uint64_t clock;
+	uint64_t tick;				/* cycles per tick */
+	uint64_t tick_overhead;		/* cycles of every Systick Handler */
+	uint64_t switch_overhead;	/* cycles of every context switch, including the scheduler call that pended it */
+	uint64_t duration;			/* cycles per trial */
+	uint32_t quantum;			/* ticks, 0 turns time slicing off */
+	uint32_t trials;
+	uint32_t workers;
+	uint64_t seed;
+	sim_policy_type policy;
+} sim_config_type;
+
+/* Per thread results, one set per worker that is merged at the end */
+typedef struct {
+	uint64_t jobs;
+	uint64_t misses;
+	uint64_t trials_missed;
+	uint64_t response_max;
+	uint64_t histogram[SIM_BUCKETS];
+} sim_stats_type;
+
+/* Simulated thread. next and prev link the ready list of its priority like the tcb links do in Src/kernel.c */
+typedef struct {
+	uint8_t next;
+	uint8_t prev;
+	uint8_t ready;
+	uint32_t slice;
+	uint64_t released;			/* jobs released so far */
+	uint64_t completed;			/* jobs finished so far, the current job is number completed */
+	uint64_t remaining;			/* cycles left of the current job */
+	uint64_t next_release;		/* actual time of the next release, jitter included */
+	uint8_t missed;
+} sim_thread_type;
+
+/* The scheduler state of one trial, shaped after the statics in Src/kernel.c */
+typedef struct {
+	sim_thread_type threads[SIM_THREADS_MAX];
+	uint8_t heads[KERNEL_PRIORITY_MAX + 1];
+	kernel_bitmap_type ready_mask;
+	uint8_t index;				/* last priority picked by the round robin scheduler */
+	uint8_t current;
+	uint64_t seed;
+} sim_state_type;
+
+typedef uint8_t (*sim_scheduler_type)(sim_state_type* state);
+
+typedef struct {
+	pthread_t thread;
+	sim_stats_type* stats;
+} sim_worker_type;
+
+static sim_task_type sim_tasks[SIM_THREADS_MAX];
+static uint32_t sim_task_count;
+static sim_config_type sim_config;
+static uint32_t sim_next_trial;
+
+static uint8_t sim_scheduler_priority_based(sim_state_type* state);
+static uint8_t sim_scheduler_round_robin(sim_state_type* state);
+
+/* Later policies only need a pick function and a name here */
+static const sim_scheduler_type sim_schedulers[SIM_POLICIES] = {
+	&sim_scheduler_priority_based,
+	&sim_scheduler_round_robin
+};
+
+static const char* const sim_policy_names[SIM_POLICIES] = {
+	"priority",
+	"round_robin"
+};
+
+/* splitmix64, good enough to seed from consecutive trial numbers */
+static uint64_t sim_random(sim_state_type* state)
+{
+	uint64_t z = (state->seed += 0x9E3779B97F4A7C15ULL);
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+/* Uniform in [low, high] */
+static uint64_t sim_uniform(sim_state_type* state, uint64_t low, uint64_t high)
+{
+	if (high <= low) {
+		return low;
+	}
+
+	return low + (sim_random(state) % (high - low + 1U));
+}
+
+static uint32_t sim_bucket(uint64_t value)
+{
+	uint32_t exponent;
+
+	if (value < SIM_SUB_BUCKETS) {
+		return (uint32_t)value;
+	}
+
+	exponent = 63U - (uint32_t)__builtin_clzll(value);
+	return SIM_SUB_BUCKETS + ((exponent - SIM_SUB_BITS) * SIM_SUB_BUCKETS)
+		+ (uint32_t)((value >> (exponent - SIM_SUB_BITS)) & (SIM_SUB_BUCKETS - 1U));
+}
+
+/* Middle of the values that fall in a bucket */
+static uint64_t sim_bucket_value(uint32_t bucket)
+{
+	uint32_t exponent;
+	uint64_t low;
+
+	if (bucket < SIM_SUB_BUCKETS) {
+		return bucket;
+	}
+
+	exponent = ((bucket - SIM_SUB_BUCKETS) / SIM_SUB_BUCKETS) + SIM_SUB_BITS;
+	low = (uint64_t)(SIM_SUB_BUCKETS + ((bucket - SIM_SUB_BUCKETS) % SIM_SUB_BUCKETS)) << (exponent - SIM_SUB_BITS);
+	return low + ((1ULL << (exponent - SIM_SUB_BITS)) / 2U);
+}
+
+/* Same as kernel_tcb_ready_insert(): append at the tail and start a fresh slice */
+static void sim_ready_insert(sim_state_type* state, uint8_t id)
+{
+	sim_thread_type* thread = &state->threads[id];
+	uint8_t priority = sim_tasks[id].priority;
+	uint8_t head = state->heads[priority];
+
+	thread->slice = sim_config.quantum;
+	thread->ready = 1U;
+
+	if (head == SIM_NONE) {
+		thread->next = id;
+		thread->prev = id;
+		state->heads[priority] = id;
+		kernel_bitmap_set(&state->ready_mask, priority);
+	} else {
+		thread->next = head;
+		thread->prev = state->threads[head].prev;
+		state->threads[thread->prev].next = id;
+		state->threads[head].prev = id;
+	}
+}
+
+/* Same as kernel_tcb_ready_remove() */
+static void sim_ready_remove(sim_state_type* state, uint8_t id)
+{
+	sim_thread_type* thread = &state->threads[id];
+	uint8_t priority = sim_tasks[id].priority;
+
+	thread->ready = 0U;
+
+	if (thread->next == id) {
+		state->heads[priority] = SIM_NONE;
+		kernel_bitmap_clear(&state->ready_mask, priority);
+	} else {
+		state->threads[thread->prev].next = thread->next;
+		state->threads[thread->next].prev = thread->prev;
+
+		if (state->heads[priority] == id) {
+			state->heads[priority] = thread->next;
+		}
+	}
+}
+
+/* Same as kernel_tcb_time_slice() */
+static void sim_time_slice(sim_state_type* state)
+{
+	uint8_t id = state->current;
+	sim_thread_type* thread;
+
+	if (id == SIM_NONE) {
+		return;
+	}
+
+	thread = &state->threads[id];
+	if ((state->heads[sim_tasks[id].priority] != id) || (thread->next == id)) {
+		return;
+	}
+
+	if ((thread->slice != 0U) && (--thread->slice == 0U)) {
+		thread->slice = sim_config.quantum;
+		state->heads[sim_tasks[id].priority] = thread->next;
+	}
+}
+
+static uint8_t sim_scheduler_priority_based(sim_state_type* state)
+{
+	if (kernel_bitmap_empty(&state->ready_mask)) {
+		return SIM_NONE;
+	}
+
+	return state->heads[kernel_bitmap_highest(&state->ready_mask)];
+}
+
+static uint8_t sim_scheduler_round_robin(sim_state_type* state)
+{
+	if (kernel_bitmap_empty(&state->ready_mask)) {
+		state->index = 0U;
+		return SIM_NONE;
+	}
+
+	state->index = kernel_bitmap_next(&state->ready_mask, state->index);
+	return state->heads[state->index];
+}
+
+static void sim_release(sim_state_type* state, uint8_t id)
+{
+	sim_thread_type* thread = &state->threads[id];
+	const sim_task_type* task = &sim_tasks[id];
+
+	thread->released++;
+	thread->next_release = (thread->released * task->period) + sim_uniform(state, 0U, task->jitter);
+
+	/* A thread that is still busy with an earlier job just gets a backlog, like a counting notification */
+	if (thread->ready == 0U) {
+		thread->remaining = sim_uniform(state, task->bcet, task->wcet);
+		sim_ready_insert(state, id);
+	}
+}
+
+static void sim_complete(sim_state_type* state, uint8_t id, uint64_t now, sim_stats_type* stats)
+{
+	sim_thread_type* thread = &state->threads[id];
+	const sim_task_type* task = &sim_tasks[id];
+	uint64_t response = now - (thread->completed * task->period);
+
+	stats[id].jobs++;
+	stats[id].histogram[sim_bucket(response)]++;
+	if (response > stats[id].response_max) {
+		stats[id].response_max = response;
+	}
+	if (response > task->deadline) {
+		stats[id].misses++;
+		thread->missed = 1U;
+	}
+
+	thread->completed++;
+	if (thread->completed < thread->released) {
+		thread->remaining = sim_uniform(state, task->bcet, task->wcet);
+	} else {
+		sim_ready_remove(state, id);
+	}
+}
+
+static void sim_trial(uint32_t trial, sim_stats_type* stats)
+{
+	static __thread sim_state_type state;
+	sim_scheduler_type scheduler = sim_schedulers[sim_config.policy];
+	uint64_t now = 0U;
+	uint64_t busy_until = 0U;		/* the CPU runs the Systick Handler or a context switch until then */
+	uint64_t next_tick = sim_config.tick;
+	uint32_t i;
+
+	memset(&state, 0, sizeof(state));
+	memset(state.heads, SIM_NONE, sizeof(state.heads));
+	state.current = SIM_NONE;
+	state.seed = sim_config.seed ^ ((uint64_t)trial * 0xD1B54A32D192ED03ULL);
+
+	for (i = 0U; i < sim_task_count; i++) {
+		state.threads[i].next_release = sim_uniform(&state, 0U, sim_tasks[i].jitter);
+	}
+
+	while (1) {
+		uint64_t start = (busy_until > now) ? busy_until : now;
+		uint64_t completion = SIM_NEVER;
+		uint64_t next = next_tick;
+		uint8_t reschedule = 0U;
+
+		if (state.current != SIM_NONE) {
+			completion = start + state.threads[state.current].remaining;
+		}
+		if (completion < next) {
+			next = completion;
+		}
+		for (i = 0U; i < sim_task_count; i++) {
+			if (state.threads[i].next_release < next) {
+				next = state.threads[i].next_release;
+			}
+		}
+		if (next >= sim_config.duration) {
+			break;
+		}
+
+		/* The running thread only makes progress outside of the kernel overhead */
+		if ((state.current != SIM_NONE) && (next > start)) {
+			state.threads[state.current].remaining -= next - start;
+		}
+		now = next;
+
+		if (now == completion) {
+			sim_complete(&state, state.current, now, stats);
+			reschedule = 1U;
+		}
+
+		for (i = 0U; i < sim_task_count; i++) {
+			if (state.threads[i].next_release == now) {
+				sim_release(&state, (uint8_t)i);
+				reschedule = 1U;
+			}
+		}
+
+		if (now == next_tick) {
+			busy_until = ((busy_until > now) ? busy_until : now) + sim_config.tick_overhead;
+			sim_time_slice(&state);
+			next_tick += sim_config.tick;
+			reschedule = 1U;
+		}
+
+		if (reschedule != 0U) {
+			uint8_t picked = scheduler(&state);
+
+			if (picked != state.current) {
+				busy_until = ((busy_until > now) ? busy_until : now) + sim_config.switch_overhead;
+				state.current = picked;
+			}
+		}
+	}
+
+	/* Jobs that were never finished miss once their deadline has passed within the trial */
+	for (i = 0U; i < sim_task_count; i++) {
+		sim_thread_type* thread = &state.threads[i];
+		uint64_t job;
+
+		for (job = thread->completed; job < thread->released; job++) {
+			if (((job * sim_tasks[i].period) + sim_tasks[i].deadline) < sim_config.duration) {
+				stats[i].jobs++;
+				stats[i].misses++;
+				thread->missed = 1U;
+			}
+		}
+
+		if (thread->missed != 0U) {
+			stats[i].trials_missed++;
+		}
+	}
+}
+
+static void* sim_worker(void* argument)
+{
+	sim_worker_type* worker = (sim_worker_type*)argument;
+
+	while (1) {
+		uint32_t trial = __atomic_fetch_add(&sim_next_trial, 1U, __ATOMIC_RELAXED);
+
+		if (trial >= sim_config.trials) {
+			break;
+		}
+		sim_trial(trial, worker->stats);
+	}
+
+	return (void*)0U;
+}
+
+static uint64_t sim_percentile(const sim_stats_type* stats, double percentile)
+{
+	uint64_t total = 0U;
+	uint64_t target;
+	uint64_t count = 0U;
+	uint32_t bucket;
+
+	for (bucket = 0U; bucket < SIM_BUCKETS; bucket++) {
+		total += stats->histogram[bucket];
+	}
+	if (total == 0U) {
+		return 0U;
+	}
+
+	target = (uint64_t)((percentile / 100.0) * (double)total);
+	if (target >= total) {
+		target = total - 1U;
+	}
+
+	for (bucket = 0U; bucket < SIM_BUCKETS; bucket++) {
+		count += stats->histogram[bucket];
+		if (count > target) {
+			break;
+		}
+	}
+
+	/* The bucket middle can lie past the largest sample in it */
+	return (sim_bucket_value(bucket) < stats->response_max) ? sim_bucket_value(bucket) : stats->response_max;
+}
+
+static double sim_us(uint64_t cycles)
+{
+	return ((double)cycles * 1000000.0) / (double)sim_config.clock;
+}
+
+static void sim_report(const sim_stats_type* stats)
+{
+	uint64_t utilization = 0U;
+	uint32_t i;
+
+	for (i = 0U; i < sim_task_count; i++) {
+		utilization += (sim_tasks[i].wcet * 1000000U) / sim_tasks[i].period;
+	}
+
+	printf("policy %s, %u trials of %.0f ms, wcet utilization %.1f%%, tick %.0f us + %llu cycles, switch %llu cycles\n\n",
+		sim_policy_names[sim_config.policy],
+		sim_config.trials,
+		sim_us(sim_config.duration) / 1000.0,
+		(double)utilization / 10000.0,
+		sim_us(sim_config.tick),
+		(unsigned long long)sim_config.tick_overhead,
+		(unsigned long long)sim_config.switch_overhead);
+
+	printf("%-16s %4s %10s %10s %10s %10s %10s %10s %10s %10s\n",
+		"thread", "prio", "jobs", "miss_job", "miss_trial", "p50_us", "p90_us", "p99_us", "p99.9_us", "max_us");
+	for (i = 0U; i < sim_task_count; i++) {
+		printf("%-16s %4u %10llu %10.6f %10.6f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+			sim_tasks[i].name,
+			(unsigned int)sim_tasks[i].priority,
+			(unsigned long long)stats[i].jobs,
+			(stats[i].jobs != 0U) ? ((double)stats[i].misses / (double)stats[i].jobs) : 0.0,
+			(double)stats[i].trials_missed / (double)sim_config.trials,
+			sim_us(sim_percentile(&stats[i], 50.0)),
+			sim_us(sim_percentile(&stats[i], 90.0)),
+			sim_us(sim_percentile(&stats[i], 99.0)),
+			sim_us(sim_percentile(&stats[i], 99.9)),
+			sim_us(stats[i].response_max));
+	}
+
+	printf("\ncsv,thread,priority,jobs,misses,trials_missed,p50_cycles,p90_cycles,p99_cycles,p999_cycles,max_cycles\n");
+	for (i = 0U; i < sim_task_count; i++) {
+		printf("csv,%s,%u,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n",
+			sim_tasks[i].name,
+			(unsigned int)sim_tasks[i].priority,
+			(unsigned long long)stats[i].jobs,
+			(unsigned long long)stats[i].misses,
+			(unsigned long long)stats[i].trials_missed,
+			(unsigned long long)sim_percentile(&stats[i], 50.0),
+			(unsigned long long)sim_percentile(&stats[i], 90.0),
+			(unsigned long long)sim_percentile(&stats[i], 99.0),
+			(unsigned long long)sim_percentile(&stats[i], 99.9),
+			(unsigned long long)stats[i].response_max);
+	}
+}
+
+static int sim_load(const char* path)
+{
+	char line[256];
+	uint32_t number = 0U;
+	FILE* file = fopen(path, "r");
+
+	if (file == (FILE*)0U) {
+		perror(path);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), file) != (char*)0U) {
+		sim_task_type* task = &sim_tasks[sim_task_count];
+		char name[SIM_NAME_LENGTH];
+		unsigned int priority;
+		unsigned long period;
+		unsigned long deadline;
+		double bcet;
+		double wcet;
+		double jitter;
+		char* comment = strchr(line, '#');
+
+		number++;
+		if (comment != (char*)0U) {
+			*comment = '\0';
+		}
+		if (strspn(line, " \t\r\n") == strlen(line)) {
+			continue;
+		}
+
+		if ((sscanf(line, " %31[^,],%u,%lu,%lu,%lf,%lf,%lf",
+				name, &priority, &period, &deadline, &bcet, &wcet, &jitter) != 7)
+			|| (priority == 0U) || (priority > KERNEL_PRIORITY_MAX) || (period == 0U)
+			|| (bcet < 0.0) || (wcet < bcet) || (jitter < 0.0)) {
+			fprintf(stderr, "%s:%u: expected name,priority,period_ticks,deadline_ticks,bcet_us,wcet_us,jitter_us "
+				"with 1 <= priority <= %u\n", path, number, (unsigned int)KERNEL_PRIORITY_MAX);
+			fclose(file);
+			return -1;
+		}
+		if (sim_task_count == SIM_THREADS_MAX) {
+			fprintf(stderr, "%s: more than %u threads\n", path, SIM_THREADS_MAX);
+			fclose(file);
+			return -1;
+		}
+
+		memcpy(task->name, name, sizeof(name));
+		task->priority = (uint8_t)priority;
+		task->period = (uint64_t)period * sim_config.tick;
+		task->deadline = ((deadline != 0U) ? (uint64_t)deadline : (uint64_t)period) * sim_config.tick;
+		task->bcet = (uint64_t)((bcet * (double)sim_config.clock) / 1000000.0);
+		task->wcet = (uint64_t)((wcet * (double)sim_config.clock) / 1000000.0);
+		task->jitter = (uint64_t)((jitter * (double)sim_config.clock) / 1000000.0);
+		if (task->jitter >= task->period) {
+			task->jitter = task->period - 1U;
+		}
+		if (task->bcet == 0U) {
+			task->bcet = 1U;
+		}
+		if (task->wcet < task->bcet) {
+			task->wcet = task->bcet;
+		}
+		sim_task_count++;
+	}
+
+	fclose(file);
+
+	if (sim_task_count == 0U) {
+		fprintf(stderr, "%s: no threads\n", path);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void sim_usage(const char* program)
+{
+	fprintf(stderr,
+		"usage: %s [options] taskset.csv\n"
+		"  --policy priority|round_robin   scheduler to replay (default priority)\n"
+		"  --trials N                      independent trials (default 1000)\n"
+		"  --duration TICKS                length of every trial (default 10000)\n"
+		"  --quantum TICKS                 time slice, 0 turns it off (default %u)\n"
+		"  --tick-overhead CYCLES          cost of every Systick Handler (default 0)\n"
+		"  --switch-overhead CYCLES        cost of every context switch (default 0)\n"
+		"  --clock HZ                      core clock (default %u)\n"
+		"  --tick-rate HZ                  ticks per second (default %u)\n"
+		"  --workers N                     host threads (default: every online core)\n"
+		"  --seed N                        base seed (default 1)\n"
+		"The overheads are best taken from Bench/bench_scaling.c and Bench/bench_rhealstone.c on the board.\n",
+		program,
+		(unsigned int)KERNEL_TIME_SLICE_TICKS,
+		(unsigned int)SYSTICK_SYSTEM_CLOCK,
+		(unsigned int)SYSTICK_TICKS_PER_SECOND);
+}
+
+int main(int argc, char** argv)
+{
+	static const struct option options[] = {
+		{"policy", required_argument, 0, 'p'},
+		{"trials", required_argument, 0, 'n'},
+		{"duration", required_argument, 0, 'd'},
+		{"quantum", required_argument, 0, 'q'},
+		{"tick-overhead", required_argument, 0, 't'},
+		{"switch-overhead", required_argument, 0, 's'},
+		{"clock", required_argument, 0, 'c'},
+		{"tick-rate", required_argument, 0, 'r'},
+		{"workers", required_argument, 0, 'w'},
+		{"seed", required_argument, 0, 'S'},
+		{"help", no_argument, 0, 'h'},
+		{0, 0, 0, 0}
+	};
+	sim_worker_type* workers;
+	sim_stats_type* totals;
+	uint64_t duration_ticks = 10000U;
+	uint64_t tick_rate = SYSTICK_TICKS_PER_SECOND;
+	uint32_t i;
+	uint32_t j;
+	uint32_t k;
+	int option;
+
+	sim_config.clock = SYSTICK_SYSTEM_CLOCK;
+	sim_config.quantum = KERNEL_TIME_SLICE_TICKS;
+	sim_config.trials = 1000U;
+	sim_config.workers = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+	sim_config.seed = 1U;
+	sim_config.policy = SIM_POLICY_PRIORITY;
+
+	while ((option = getopt_long(argc, argv, "h", options, (int*)0U)) != -1) {
+		switch (option) {
+		case 'p':
+			for (i = 0U; (i < SIM_POLICIES) && (strcmp(optarg, sim_policy_names[i]) != 0); i++) {}
+			if (i == SIM_POLICIES) {
+				fprintf(stderr, "unknown policy %s\n", optarg);
+				return 2;
+			}
+			sim_config.policy = (sim_policy_type)i;
+			break;
+		case 'n':
+			sim_config.trials = (uint32_t)strtoul(optarg, (char**)0U, 0);
+			break;
+		case 'd':
+			duration_ticks = strtoull(optarg, (char**)0U, 0);
+			break;
+		case 'q':
+			sim_config.quantum = (uint32_t)strtoul(optarg, (char**)0U, 0);
+			break;
+		case 't':
+			sim_config.tick_overhead = strtoull(optarg, (char**)0U, 0);
+			break;
+		case 's':
+			sim_config.switch_overhead = strtoull(optarg, (char**)0U, 0);
+			break;
+		case 'c':
+			sim_config.clock = strtoull(optarg, (char**)0U, 0);
+			break;
+		case 'r':
+			tick_rate = strtoull(optarg, (char**)0U, 0);
+			break;
+		case 'w':
+			sim_config.workers = (uint32_t)strtoul(optarg, (char**)0U, 0);
+			break;
+		case 'S':
+			sim_config.seed = strtoull(optarg, (char**)0U, 0);
+			break;
+		default:
+			sim_usage(argv[0]);
+			return (option == 'h') ? 0 : 2;
+		}
+	}
+
+	if ((optind + 1) != argc) {
+		sim_usage(argv[0]);
+		return 2;
+	}
+	if ((tick_rate == 0U) || (sim_config.clock < tick_rate) || (sim_config.trials == 0U) || (duration_ticks == 0U)) {
+		fprintf(stderr, "clock, tick rate, trials and duration must be non zero, with at least one cycle per tick\n");
+		return 2;
+	}
+	if (sim_config.workers == 0U) {
+		sim_config.workers = 1U;
+	}
+
+	sim_config.tick = sim_config.clock / tick_rate;
+	sim_config.duration = duration_ticks * sim_config.tick;
+
+	if (sim_load(argv[optind]) != 0) {
+		return 2;
+	}
+
+	workers = calloc(sim_config.workers, sizeof(*workers));
+	totals = calloc(sim_task_count, sizeof(*totals));
+	if ((workers == (sim_worker_type*)0U) || (totals == (sim_stats_type*)0U)) {
+		fprintf(stderr, "out of memory\n");
+		return 2;
+	}
+
+	for (i = 0U; i < sim_config.workers; i++) {
+		workers[i].stats = calloc(sim_task_count, sizeof(sim_stats_type));
+		if ((workers[i].stats == (sim_stats_type*)0U)
+			|| (pthread_create(&workers[i].thread, (const pthread_attr_t*)0U, &sim_worker, &workers[i]) != 0)) {
+			fprintf(stderr, "starting worker %u failed\n", i);
+			return 2;
+		}
+	}
+
+	for (i = 0U; i < sim_config.workers; i++) {
+		pthread_join(workers[i].thread, (void**)0U);
+
+		for (j = 0U; j < sim_task_count; j++) {
+			const sim_stats_type* stats = &workers[i].stats[j];
+
+			totals[j].jobs += stats->jobs;
+			totals[j].misses += stats->misses;
+			totals[j].trials_missed += stats->trials_missed;
+			if (stats->response_max > totals[j].response_max) {
+				totals[j].response_max = stats->response_max;
+			}
+			for (k = 0U; k < SIM_BUCKETS; k++) {
+				totals[j].histogram[k] += stats->histogram[k];
+			}
+		}
+		free(workers[i].stats);
+	}
+
+	sim_report(totals);
+
+	free(totals);
+	free(workers);
+	return 0;
+}